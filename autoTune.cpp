@@ -0,0 +1,358 @@
+/*
+ * File Name   :autoTune.cpp
+ * Description :Start up auto tuner of the DistributedMatrix options with a persisted tuning cache
+ *
+ * Cache file format, one line per tuned problem :
+ * n=<matSize> a=<name of A> p=<no of ranks> dtype=<element type> host=<hostname> cpu=<cpu model><TAB><shm> <hier> <rma> <persist> <tile>
+ *
+ */
+
+/* Debug prints will be enabled if set to 1 */
+#define DEBUG 0
+#define NODE_0 0
+
+/* iterations timed per candidate, after one warm up iteration */
+#define TUNE_TRIAL_ITERS 3
+
+#define TUNE_KEY_SIZE 1024
+#define TUNE_LINE_SIZE 2048
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "autoTune.h"
+
+inline namespace DISTMATMUL_ABI {
+
+/* communication variant flags in the order they are stored in the cache */
+#define TUNE_NUM_FLAGS 4
+/* tile sizes tried with the best communication variant, 0 - whole rows */
+static const int tuneTiles[] = { 0, 512, 4096 };
+
+
+/*==============================================================================
+ *  GetCpuModel
+ *=============================================================================*/
+
+static void GetCpuModel (char *model, size_t size)
+{
+    FILE * fp = fopen ("/proc/cpuinfo", "r");
+    char line[TUNE_LINE_SIZE];
+
+    snprintf (model, size, "unknown");
+    if (fp == NULL) {
+        return;
+    }
+
+    while (fgets (line, sizeof(line), fp) != NULL) {
+        if (strncmp (line, "model name", 10) == 0) {
+            char * value = strchr (line, ':');
+
+            if (value != NULL) {
+                value++;
+                while (*value == ' ') {
+                    value++;
+                }
+                value[strcspn (value, "\n")] = '\0';
+                snprintf (model, size, "%s", value);
+            }
+            break;
+        }
+    }
+    fclose (fp);
+}
+
+/*==============================================================================
+ *  MakeTuneKey
+ *=============================================================================*/
+
+static void MakeTuneKey (char *key, size_t size, int matSize, const char *matName, int numprocs)
+{
+    char host[256];
+    char model[256];
+
+    if (gethostname (host, sizeof(host)) != 0) {
+        snprintf (host, sizeof(host), "unknown");
+    }
+    host[sizeof(host) - 1] = '\0';
+    GetCpuModel (model, sizeof(model));
+
+#if (MOD_ARITH)
+    snprintf (key, size, "n=%d a=%s p=%d dtype=u32mod%llu host=%s cpu=%s", matSize, matName, numprocs, (unsigned long long) (MOD_PRIME), host, model);
+#else
+    snprintf (key, size, "n=%d a=%s p=%d dtype=i64 host=%s cpu=%s", matSize, matName, numprocs, host, model);
+#endif
+}
+
+/*==============================================================================
+ *  SetTuneFlags
+ *=============================================================================*/
+
+static void SetTuneFlags (MatMulOptions *opts, const int *flags)
+{
+    opts->sharedVector = flags[0];
+    opts->hierColl = flags[1];
+    opts->rmaTranspose = flags[2];
+    opts->persistComm = flags[3];
+}
+
+/*==============================================================================
+ *  CacheLookup
+ *=============================================================================*/
+
+/* reads the tuned values of key, the last entry of the key wins */
+static CStatus CacheLookup (const char *path, const char *key, int *values)
+{
+    FILE * fp = fopen (path, "r");
+    char line[TUNE_LINE_SIZE];
+    size_t keyLen = strlen (key);
+    CStatus status = C_DATA_EOF;
+
+    if (fp == NULL) {
+        return C_DATA_EOF;
+    }
+
+    while (fgets (line, sizeof(line), fp) != NULL) {
+
+        int found[TUNE_NUM_FLAGS + 1];
+
+        if (strncmp (line, key, keyLen) != 0 || line[keyLen] != '\t') {
+            continue;
+        }
+        if (sscanf (line + keyLen + 1, "%d %d %d %d %d", &found[0], &found[1], &found[2], &found[3], &found[4]) == 5) {
+            memcpy (values, found, sizeof(found));
+            status = C_SUCCESS;
+        }
+    }
+    fclose (fp);
+
+    return status;
+}
+
+/*==============================================================================
+ *  CacheStore
+ *=============================================================================*/
+
+static CStatus CacheStore (const char *path, const char *key, const int *values)
+{
+    FILE * fp = fopen (path, "a");
+
+    if (fp == NULL) {
+        DLOG (C_WARNING, "could not open the tuning cache %s, the tuned options are not saved\n", path);
+        return C_FAILURE;
+    }
+
+    fprintf (fp, "%s\t%d %d %d %d %d\n", key, values[0], values[1], values[2], values[3], values[4]);
+    fclose (fp);
+
+    return C_SUCCESS;
+}
+
+/*==============================================================================
+ *  TimeTrial
+ *=============================================================================*/
+
+/* seconds per iteration of the slowest rank with opts set on the session, a negative value if they could not be set */
+static double TimeTrial (MPI_Comm comm, DistributedMatrix &distMatrix, const MatMulOptions &opts, matElem_t *x)
+{
+    double startTime, trialTime;
+
+    if (distMatrix.SetOptions (opts) != C_SUCCESS) {
+        return -1.0;
+    }
+
+    /* warm up, the first iteration also pays for the first touch of the vectors & windows */
+    distMatrix.Iterate (x, 1);
+
+    MPI_Barrier (comm);
+    startTime = MPI_Wtime ();
+    distMatrix.Iterate (x, TUNE_TRIAL_ITERS);
+    trialTime = (MPI_Wtime () - startTime) / TUNE_TRIAL_ITERS;
+
+    MPI_Allreduce (MPI_IN_PLACE, &trialTime, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+    return trialTime;
+}
+
+/*==============================================================================
+ *  TuneOptions
+ *=============================================================================*/
+
+/* MatrixBlockFn of the built in generators, ctx points to the matType */
+static void GenerateTrialBlock (matElem_t **block, int rowOffset, int colmOffset, int rows, int colms, void *ctx)
+{
+    FillMatrix (block, rows, colms, rowOffset, colmOffset, *(const int *) ctx);
+}
+
+CStatus TuneOptions (MPI_Comm comm, int matSize, int matType, const char *cachePath, MatMulOptions *opts)
+{
+    /* the generators are named by their no in the cache key */
+    char matName[16];
+
+    snprintf (matName, sizeof(matName), "%d", matType);
+    return TuneOptions (comm, matSize, GenerateTrialBlock, &matType, matName, cachePath, opts);
+}
+
+CStatus TuneOptions (MPI_Comm comm, int matSize, MatrixBlockFn fillBlock, void *ctx, const char *matName,
+        const char *cachePath, MatMulOptions *opts)
+{
+    int myRank, numprocs;
+    char key[TUNE_KEY_SIZE];
+    /* shm, hier, rma, persist, tile & a found flag */
+    int tuned[TUNE_NUM_FLAGS + 2] = {0};
+    int gridDim = 1;
+
+    /* the name is a field of a line of the cache */
+    if (fillBlock == NULL || matName == NULL || matName[0] == '\0' || strpbrk (matName, " \t\n") != NULL) {
+        return C_INVALID_ARGS;
+    }
+
+    MPI_Comm_rank (comm, &myRank);
+    MPI_Comm_size (comm, &numprocs);
+
+    while ((gridDim + 1) * (gridDim + 1) <= numprocs) {
+        gridDim++;
+    }
+
+    if (cachePath == NULL) {
+        cachePath = getenv ("MATMUL_TUNE_CACHE");
+    }
+    if (cachePath == NULL) {
+        cachePath = TUNE_CACHE_DEFAULT;
+    }
+
+    /* rank 0 looks the key up, the other ranks get the result with a single broadcast */
+    if (myRank == NODE_0) {
+        MakeTuneKey (key, sizeof(key), matSize, matName, numprocs);
+        tuned[TUNE_NUM_FLAGS + 1] = (CacheLookup (cachePath, key, tuned) == C_SUCCESS);
+    }
+    MPI_Bcast (tuned, TUNE_NUM_FLAGS + 2, MPI_INT, NODE_0, comm);
+
+    if (tuned[TUNE_NUM_FLAGS + 1]) {
+        SetTuneFlags (opts, tuned);
+        opts->tileSize = tuned[TUNE_NUM_FLAGS];
+        DLOG (C_VERBOSE, "Node[%d] tuned options loaded from %s\n", myRank, cachePath);
+        return C_SUCCESS;
+    }
+
+    DLOG (C_VERBOSE, "Node[%d] no tuned options in %s, running the trials\n", myRank, cachePath);
+
+    matElem_t * x = NULL;
+    if (myRank == NODE_0) {
+        InitVector (&x, matSize, ALL_SET_1);
+    }
+
+    MatMulOptions trialOpts = *opts;
+    double bestTime = -1.0;
+    int bestFlags[TUNE_NUM_FLAGS] = {0};
+    int bestTile = 0;
+
+    /*
+     * the communication variants are tried first with whole rows, then the
+     * tile sizes with the best variant. A is built once per grid placement,
+     * i.e. per value of hierColl, the other variants & the tile sizes only
+     * set up the vectors, windows & requests of the session again.
+     */
+    DistributedMatrix distMatrix;
+    int sessionHier = -1;
+
+    trialOpts.tileSize = 0;
+    for (int hier = 0; hier <= 1; hier++) {
+
+        distMatrix.Destroy ();
+        sessionHier = -1;
+
+        trialOpts.hierColl = hier;
+        if (distMatrix.Create (comm, matSize, fillBlock, ctx, trialOpts) != C_SUCCESS) {
+            continue;
+        }
+        sessionHier = hier;
+
+        for (int variant = 0; variant < (1 << TUNE_NUM_FLAGS); variant++) {
+
+            int flags[TUNE_NUM_FLAGS];
+
+            for (int f = 0; f < TUNE_NUM_FLAGS; f++) {
+                flags[f] = (variant >> f) & 1;
+            }
+            if (flags[1] != hier) {
+                continue;
+            }
+            /* a single rank has no result to transpose */
+            if (numprocs == 1 && flags[2]) {
+                continue;
+            }
+
+            SetTuneFlags (&trialOpts, flags);
+            double trialTime = TimeTrial (comm, distMatrix, trialOpts, x);
+
+            DLOG (C_VERBOSE, "Node[%d] shm %d hier %d rma %d persist %d : %g s per iteration\n",
+                    myRank, flags[0], flags[1], flags[2], flags[3], trialTime);
+
+            if (trialTime >= 0 && (bestTime < 0 || trialTime < bestTime)) {
+                bestTime = trialTime;
+                memcpy (bestFlags, flags, sizeof(bestFlags));
+            }
+        }
+    }
+
+    SetTuneFlags (&trialOpts, bestFlags);
+    if (bestTime >= 0 && sessionHier != bestFlags[1]) {
+        distMatrix.Destroy ();
+        if (distMatrix.Create (comm, matSize, fillBlock, ctx, trialOpts) != C_SUCCESS) {
+            bestTime = -1.0;
+        }
+    }
+
+    if (bestTime < 0) {
+        distMatrix.Destroy ();
+        delete [] x;
+        return C_FAILURE;
+    }
+
+    /*
+     * only the dense kernel is tiled, the tile sizes are not tried if no rank holds a dense block.
+     * The structured kernels would time the same for every tile & the choice would be noise.
+     */
+    int anyDense = (distMatrix.BlockKind () == BLOCK_DENSE);
+    MPI_Allreduce (MPI_IN_PLACE, &anyDense, 1, MPI_INT, MPI_MAX, comm);
+
+    for (size_t t = 1; anyDense && t < sizeof(tuneTiles) / sizeof(tuneTiles[0]); t++) {
+
+        /* a tile as wide as the block is the same as whole rows */
+        if (tuneTiles[t] >= matSize / gridDim) {
+            continue;
+        }
+
+        trialOpts.tileSize = tuneTiles[t];
+        double trialTime = TimeTrial (comm, distMatrix, trialOpts, x);
+
+        DLOG (C_VERBOSE, "Node[%d] tile %d : %g s per iteration\n", myRank, tuneTiles[t], trialTime);
+
+        if (trialTime >= 0 && trialTime < bestTime) {
+            bestTime = trialTime;
+            bestTile = tuneTiles[t];
+        }
+    }
+
+    distMatrix.Destroy ();
+    delete [] x;
+
+    SetTuneFlags (opts, bestFlags);
+    opts->tileSize = bestTile;
+
+    if (myRank == NODE_0) {
+        memcpy (tuned, bestFlags, sizeof(bestFlags));
+        tuned[TUNE_NUM_FLAGS] = bestTile;
+        CacheStore (cachePath, key, tuned);
+        DLOG (C_INFO, "tuned %s : shm %d hier %d rma %d persist %d tile %d, %g s per iteration\n",
+                key, bestFlags[0], bestFlags[1], bestFlags[2], bestFlags[3], bestTile, bestTime);
+    }
+
+    return C_SUCCESS;
+}
+
+} /* namespace DISTMATMUL_ABI */
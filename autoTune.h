@@ -0,0 +1,41 @@
+/*
+ * File Name       :autoTune.h
+ *
+ * Start up auto tuner of the DistributedMatrix options. The candidates are timed with short
+ * trial runs on the actual machine & problem size, the winner is stored in a tuning cache
+ * keyed by (n, A, p, dtype, host, cpu model) so that later runs load it without any trials.
+ *
+ */
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <mpi.h>
+
+#include "CommonHeader.h"
+#include "distMatMul.h"
+
+/* tuning cache used when the MATMUL_TUNE_CACHE environment variable is not set */
+#define TUNE_CACHE_DEFAULT "matMul.tune"
+
+inline namespace DISTMATMUL_ABI {
+
+/*
+ * picks the communication variant & the tile size for the given problem, collective over comm.
+ * The cache at rank 0 is looked up first, on a miss every candidate is timed & the winner is
+ * appended to the cache. Placement options already set in opts (pinning, huge pages) are kept.
+ * matType   - generator of A, the trials run on that matrix & the tile size is tuned only if a block of it is dense
+ * cachePath - tuning cache file, NULL for $MATMUL_TUNE_CACHE or TUNE_CACHE_DEFAULT
+ */
+CStatus TuneOptions (MPI_Comm comm, int matSize, int matType, const char *cachePath, MatMulOptions *opts);
+/*
+ * the same with A supplied by the caller, as in DistributedMatrix::Create. Tune on this one to get a tile size for a dense A.
+ * fillBlock - fills a block of A, see MatrixBlockFn
+ * ctx       - passed to fillBlock as is
+ * matName   - names A in the cache key, without blanks, so that the choices for different matrices are kept apart
+ */
+CStatus TuneOptions (MPI_Comm comm, int matSize, MatrixBlockFn fillBlock, void *ctx, const char *matName,
+        const char *cachePath, MatMulOptions *opts);
+
+} /* namespace DISTMATMUL_ABI */
+
+#endif /* AUTOTUNE_H */
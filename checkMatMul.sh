@@ -0,0 +1,96 @@
+#!/bin/sh
+# File Name       :checkMatMul.sh
+# Description     :Script to check x(20) of matMul against seqMatMul, run by make check
+# Author          :Karthik Rao
+# Date            :Dec 06 2017
+# Version         :0.1
+#
+# Both modes of libdistMatMul are built under build/check-<mode> with the balance thresholds lowered,
+# so that -balance moves rows between the ranks on the timer noise alone.
+# MPIRUN may be set to the launcher, e.g. MPIRUN="mpirun --oversubscribe" on a host with fewer cores than 9.
+
+
+ROOT=$(cd "$(dirname "$0")" && pwd)
+MAKE=${MAKE:-make}
+MPIRUN=${MPIRUN:-mpirun}
+
+N=36
+
+PROCS="1 4 9"
+
+OPTIONS="none -shm,-persist,-tile,5 -hier,-rma -balance,1"
+
+# flags of the check build, a rebalance only needs a predicted gain
+CHECKFLAGS="-DBALANCE_TOLERANCE=0.0 -DBALANCE_MIN_GAIN=1e-6 -DBALANCE_MIN_SAVING=0.0"
+
+FAILED=0
+
+for MODULAR in 0 1;
+do
+    BUILDDIR=${ROOT}/build/check-${MODULAR}
+    BINDIR=${BUILDDIR}/bin
+
+    mkdir -p ${BINDIR}
+
+    if ! ${MAKE} -s -C ${ROOT} modular=${MODULAR} BUILDROOT=${BUILDDIR} BINDIR=${BINDIR} \
+        EXTRAFLAGS="${CHECKFLAGS}" matMul seqMatMul > /dev/null;
+    then
+        echo "FAIL modular=${MODULAR} build"
+        exit 1
+    fi
+
+    # the elements of x(20) overflow 64 bits for the sparse & the dense matrix, they are checked mod MOD_PRIME only
+    if [ ${MODULAR} -eq 1 ];
+    then
+        MATRICES="identity sparse banded dense"
+    else
+        MATRICES="identity banded"
+    fi
+
+    for MATRIX in ${MATRICES};
+    do
+        ${BINDIR}/seqMatMul ${N} -matrix ${MATRIX} -print 2> /dev/null > ${BUILDDIR}/seq_${MATRIX}
+
+        for P in ${PROCS};
+        do
+            for OPTION in ${OPTIONS};
+            do
+                if [ "${OPTION}" = "none" ];
+                then
+                    ARGS=""
+                else
+                    ARGS=$(echo ${OPTION} | tr ',' ' ')
+                fi
+
+                NAME="modular=${MODULAR} -n ${P} -matrix ${MATRIX} ${ARGS}"
+                OUT=${BUILDDIR}/mul_${MATRIX}_${P}_$(echo ${OPTION} | tr -d ",-")
+
+                if ! ${MPIRUN} -n ${P} ${BINDIR}/matMul ${N} -matrix ${MATRIX} ${ARGS} -print > ${OUT} 2> /dev/null;
+                then
+                    echo "FAIL ${NAME}, matMul failed, see ${OUT}"
+                    FAILED=1
+                    continue
+                fi
+
+                # the library logs to stdout as well, x(20) is every line holding a number only
+                if ! grep -E '^-?[0-9]+$' ${OUT} | cmp -s - ${BUILDDIR}/seq_${MATRIX};
+                then
+                    echo "FAIL ${NAME}, x(20) differs from seqMatMul, see ${OUT}"
+                    FAILED=1
+                    continue
+                fi
+
+                if [ "${OPTION}" = "-balance,1" ] && [ ${P} -gt 1 ] && ! grep -q "rebalancing the blocks" ${OUT};
+                then
+                    echo "FAIL ${NAME}, the blocks were not rebalanced, see ${OUT}"
+                    FAILED=1
+                    continue
+                fi
+
+                echo "PASS ${NAME}"
+            done
+        done
+    done
+done
+
+exit ${FAILED}
@@ -0,0 +1,1764 @@
+/*
+ * File Name   :distMatMul.cpp
+ * Description :Implementation of MPI based parallel code for matrix multiplication
+ *               with block decomposition based partitioning, as a reusable session
+ *
+ *  1.  at every node create a block of submatrix of matrix A, i.e matrix A is distributed across all the nodes
+ *  2.  create 2D cartesin topology of nodes resulting in a grid. group all the nodes in a row as a single communicator.
+ *      Similarly group all the nodes in the column as one communicator
+ *  2.1 the columns of the vector X(t-1) are scattered to the nodes with coordinates (0,i) in the grid. The nodes with
+ *      coordinate (0,i) are the leaders for the column communicator similarly (i,0) nodes are the leaders for the row communicators.
+ *  3.  at every leader node, broadcast the columns of X(t-1) to its column communicator group
+ *  4.  every node multiplies the sub matrix A with the corresponding columns of vector X(t-1)
+ *  5.  The result of the multiplication at every row communicators gets reduced at the leader.
+ *      Hence, the leader of each row communicator will have the few columns of the resultant X(t).
+ *  5.1 The row leaders sends the result X(t) to the column leaders.
+ *  6.  This X(t) would be used as X(t-1) for the next computation. The column leaders would braodcast the X(t) to all the
+ *      nodes in its column communicator. If k iterations have not been done then go to step 4, else goto step 7
+ *  7.  gather the columns of X(t) from every column leader at node 0.
+ *
+ * Steps 1 & 2 are done once by DistributedMatrix::Create, steps 2.1 to 7 by every DistributedMatrix::Iterate.
+ *
+ */
+
+/* Debug prints will be enabled if set to 1 */
+#define DEBUG 0
+#define NODE_0 0
+#define TWO_DIMENSION 2
+#define NO_REORDER 0
+
+#define VECTOR_COLUMN_RESULT 12
+#define MIGRATE_MATRIX_TAG 13
+
+/* 64 bit accumulators of the modular dot product, a multiple of the widest SIMD register */
+#define MOD_LANES 8
+
+/*
+ * the blocks are rebalanced only if the slowest block is this much slower than the mean. The three thresholds
+ * can be lowered at build time, make check lowers them to rebalance on the timer noise alone
+ */
+#ifndef BALANCE_TOLERANCE
+#define BALANCE_TOLERANCE 1.1
+#endif
+/* & the new blocks are predicted to cut the time of the slowest block by at least this fraction */
+#ifndef BALANCE_MIN_GAIN
+#define BALANCE_MIN_GAIN 0.1
+#endif
+/* & by at least this many seconds per check, below it the timer noise & the migration outweigh the gain */
+#ifndef BALANCE_MIN_SAVING
+#define BALANCE_MIN_SAVING 1e-3
+#endif
+/* lowest time per element of a block, as a fraction of the highest */
+#define BALANCE_MIN_RATE 1e-3
+/* weight of the earlier checks in the time per element of a block */
+#define BALANCE_SMOOTHING 0.5
+/* values sent by every block to the balance check */
+#define BALANCE_REPORT 3
+
+/* MPI-4 persistent collectives, MPI_Bcast_init etc. */
+#if defined(MPI_VERSION) && (MPI_VERSION >= 4)
+#define PERSISTENT_COLL 1
+#else
+#define PERSISTENT_COLL 0
+#endif
+
+#include <mpi.h>
+#include <stdio.h>
+#include <iostream>
+#include <string.h>
+#include <cmath>
+
+#include "distMatMul.h"
+
+inline namespace DISTMATMUL_ABI {
+
+#if (MOD_ARITH)
+/* function multiplies the sub matrix A with the vector X mod MOD_PRIME, tileSize columns at a time */
+static void MatVecMod (matElem_t **mat, const matElem_t *vectIn, matElem_t *vectOut, int rows, int colms, int tileSize);
+/* user defined MPI reduction operator, adds the vectors mod MOD_PRIME */
+static void ModSumOp (void *in, void *inout, int *len, MPI_Datatype *type);
+#else
+/* function multiplies the sub matrix A with the vector X, tileSize columns at a time */
+static void MatVec (matElem_t **mat, const matElem_t *vectIn, matElem_t *vectOut, int rows, int colms, int tileSize);
+#endif
+/* function multiplies a diagonal, banded or Toeplitz block with the vector X */
+static void MatVecStructured (const BlockStructure *shape, matElem_t **mat, const matElem_t *vectIn, matElem_t *vectOut, int rows, int colms);
+/* function returns the length of the overlap of [start1, end1) & [start2, end2), & its start */
+static int RangeOverlap (int start1, int end1, int start2, int end2, int *start);
+/* function creates the datatype of the rows x colms rectangle at (rowStart, colmStart) of a blockRows x blockColms block */
+static void BlockRectType (int blockRows, int blockColms, int rowStart, int colmStart, int rows, int colms, MPI_Datatype *rectType);
+/* function returns the no of elements of a block multiplied by its kernel & sets perColm if that grows with the columns */
+static double BlockWork (const BlockStructure *shape, int rows, int colms, int *perColm);
+/* function splits the rows & columns of A in proportion to the speed of the blocks, from their compute times.
+ * reports - BALANCE_REPORT values per block, the compute time, the BlockWork & its perColm
+ * rates   - time per element of work of every block averaged over the earlier calls, -1 before the 1st one */
+static void BalancePartition (const double *reports, int gridDim, const int *partition, double *rates, int *newPartition);
+/* function allocates the shared window holding X for the ranks of the column on this host */
+static CStatus SharedVectorCreate (SharedVector *shVect, MPI_Comm comm_node, MPI_Comm comm_colm, int vectSize);
+/* function makes the writes of the host leader visible to the other ranks on the host */
+static void SharedVectorSync (SharedVector *shVect, MPI_Comm comm_node);
+/* function frees the shared window & its communicators */
+static void SharedVectorFree (SharedVector *shVect);
+/* function starts a persistent request & waits for it to complete */
+static void CommPlanRun (MPI_Request *req);
+/* function frees the persistent requests */
+static void CommPlanFree (CommPlan *plan);
+
+
+/*==============================================================================
+ *  DistributedMatrix
+ *=============================================================================*/
+
+DistributedMatrix::DistributedMatrix () : created (0), matSize (0), subMatRowSize (0), subMatColmSize (0), subVecColmSize (0) {
+
+    DefaultOptions (&opts);
+    blockShape.kind = BLOCK_ZERO;
+    blockShape.bandLow = blockShape.bandHigh = 0;
+    blockShape.diags = NULL;
+}
+
+DistributedMatrix::~DistributedMatrix () {
+
+    Destroy ();
+}
+
+/*==============================================================================
+ *  DistributedMatrix::Create
+ *=============================================================================*/
+
+/* MatrixBlockFn of the built in generators, ctx points to the matType */
+static void GenerateBlock (matElem_t **block, int rowOffset, int colmOffset, int rows, int colms, void *ctx) {
+
+    FillMatrix (block, rows, colms, rowOffset, colmOffset, *(const int *) ctx);
+}
+
+CStatus DistributedMatrix::Create (MPI_Comm commIn, int matSizeIn, int matType, const MatMulOptions &optsIn) {
+
+    return Create (commIn, matSizeIn, GenerateBlock, &matType, optsIn);
+}
+
+CStatus DistributedMatrix::Create (MPI_Comm commIn, int matSizeIn, MatrixBlockFn fillBlock, void *ctx,
+        const MatMulOptions &optsIn) {
+
+    if (created) {
+        return C_INVALID_HANDLE;
+    }
+
+    if (fillBlock == NULL) {
+        DLOG (C_ERROR, " no function to fill the blocks of A\n");
+        return C_INVALID_ARGS;
+    }
+
+    comm = commIn;
+    matSize = matSizeIn;
+    opts = optsIn;
+    MPI_Comm_size (comm, &numprocs);
+    MPI_Comm_rank (comm, &myRank);
+
+    gridDim = (int) sqrt ((double) numprocs);
+    if (gridDim * gridDim != numprocs) {
+        DLOG (C_ERROR, " no of processors should be a perfect square\n");
+        return C_INVALID_ARGS;
+    }
+
+    if ( matSize < 4) {
+        DLOG (C_ERROR, " matrix size should be greater than 4\n");
+        return C_INVALID_ARGS;
+    }
+
+    if ( (((long) matSize * matSize) % numprocs) !=0) {
+        DLOG (C_ERROR, " matrix size not compatible with the no of processors\n");
+        return C_INVALID_ARGS;
+    }
+
+    /* a single node has no result to transpose */
+    if (numprocs == 1) {
+        opts.rmaTranspose = 0;
+    }
+
+    /*
+     * group the ranks sharing a host, the local rank decides the core a rank is pinned to
+     */
+    int nodeRank, nodeSize;
+    MPI_Comm_split_type (comm, MPI_COMM_TYPE_SHARED, myRank, MPI_INFO_NULL, &comm_node);
+    MPI_Comm_rank (comm_node, &nodeRank);
+    MPI_Comm_size (comm_node, &nodeSize);
+
+    if (opts.pinRanks) {
+        int pinnedCpu;
+
+        if (TopoPinRank (nodeRank, nodeSize, &pinnedCpu) == C_SUCCESS) {
+            DLOG (C_VERBOSE, "Node[%d] local rank %d of %d pinned to cpu %d, %d NUMA nodes\n",
+                    myRank, nodeRank, nodeSize, pinnedCpu, TopoNumaNodeCount());
+        }
+    }
+
+    /*
+     * the rows & the columns of A are split at the same bounds, so the rows reduced in a grid row
+     * are the segment of X needed by the grid column of the same index. The blocks start equal.
+     */
+    partition = new int [gridDim + 1];
+    segCounts = new int [gridDim];
+    for (int k = 0; k <= gridDim; k++) {
+        partition[k] = k * (matSize / gridDim);
+    }
+    for (int k = 0; k < gridDim; k++) {
+        segCounts[k] = partition[k + 1] - partition[k];
+    }
+    computeTime = 0;
+    balanceSteps = 0;
+    blockRates = NULL;
+    if ( myRank == NODE_0) {
+        blockRates = new double [numprocs];
+        for (int k = 0; k < numprocs; k++) {
+            blockRates[k] = -1.0;
+        }
+    }
+
+    vectorFinalResult = NULL;
+    if ( myRank == NODE_0) {
+        DLOG (C_VERBOSE, "Node[%d] initializing vector to store the result\n", myRank);
+
+        InitVector (&vectorFinalResult, matSize, NULL_MATRIX);
+    }
+
+    /*
+     * partial results are added with MPI_SUM, or mod MOD_PRIME in the modular arithmetic mode
+     */
+    vectSumOp = MPI_SUM;
+#if (MOD_ARITH)
+    DLOG (C_VERBOSE, "Node[%d] creating modular sum operator\n", myRank);
+    MPI_Op_create (ModSumOp, 1, &vectSumOp);
+#endif
+
+    CreateComms ();
+
+    /* 
+     * the matrix is allocated & initialized only after pinning, so the first touch of
+     * every page happens on the NUMA node of the core that multiplies with it.
+     * The node (r,c) of the grid holds the block (r,c) of A.
+     */
+    subMatRowSize = segCounts[grid_coords[0]];
+    subMatColmSize = segCounts[grid_coords[1]];
+    subVecColmSize = subMatColmSize;
+    InitMatrix (&matrix, subMatRowSize, subMatColmSize, partition[grid_coords[0]],
+            partition[grid_coords[1]], NULL_MATRIX, opts.hugePage, &matrixBytes);
+    fillBlock (matrix, partition[grid_coords[0]], partition[grid_coords[1]], subMatRowSize, subMatColmSize, ctx);
+    ClassifyBlock (matrix, subMatRowSize, subMatColmSize, &blockShape);
+
+#if (DEBUG)
+    DLOG (C_VERBOSE, "Node[%d] Printing matrix A\n", myRank);
+    printMatrix (matrix, subMatRowSize, subMatColmSize);
+
+#endif
+    DLOG (C_VERBOSE, "Node[%d] block (%d,%d) of A is of kind %d\n", myRank, grid_coords[0], grid_coords[1], blockShape.kind);
+
+    CreateLayout ();
+
+    created = 1;
+    return C_SUCCESS;
+}
+
+/*==============================================================================
+ *  DistributedMatrix::CreateLayout
+ *=============================================================================*/
+
+void DistributedMatrix::CreateLayout () {
+
+    /* vectorResult receives the row result at (r,0) & the segment of X at the other nodes of a column */
+    int resultSize = (subMatRowSize > subVecColmSize) ? subMatRowSize : subVecColmSize;
+
+    if (!opts.sharedVector) {
+        InitVector (&vectorPast, subVecColmSize, NULL_MATRIX);
+    }
+    InitVector (&vectorCur, subMatRowSize, NULL_MATRIX);
+    InitVector (&vectorResult, resultSize, NULL_MATRIX);
+
+    /*
+     * create a contigious vector type, the segment of X of the grid column of this node
+     */
+    DLOG (C_VERBOSE, "Node[%d] creating user defined vector data type\n", myRank);
+    MPI_Type_contiguous (subVecColmSize , MAT_ELEM_MPI_TYPE , &vectType );
+    MPI_Type_commit (&vectType );
+
+    /*
+     * two level row & column communicators, the partial results of a host are reduced
+     * before they are sent to the other hosts
+     */
+    if (opts.hierColl) {
+        DLOG (C_VERBOSE, "Node[%d] creating two level row & column communicators\n", myRank);
+        TopoHierCreate (comm_row, subMatRowSize * sizeof(matElem_t), &hier_row);
+        TopoHierCreate (comm_colm, subVecColmSize * sizeof(matElem_t), &hier_colm);
+    }
+
+    CreateTranspose ();
+
+    curSlot = 0;
+    if (opts.sharedVector) {
+
+        DLOG (C_VERBOSE, "Node[%d] creating shared window for the vector\n", myRank);
+        if (SharedVectorCreate (&shVect, comm_node, comm_colm, subVecColmSize) != C_SUCCESS) {
+            CLOG_ASSERT_ERR ("SharedVectorCreate", "could not create the shared vector window", C_FAILURE);
+            MPI_Abort (comm, C_FAILURE);
+        }
+        vectorPast = shVect.slot[curSlot];
+    }
+
+    CreatePlan ();
+}
+
+/*==============================================================================
+ *  DistributedMatrix::FreeLayout
+ *=============================================================================*/
+
+void DistributedMatrix::FreeLayout () {
+
+    CommPlanFree (&plan);
+    if (opts.rmaTranspose) {
+        MPI_Win_free (&resultWin);
+        if (transposeGroup != MPI_GROUP_NULL) {
+            MPI_Group_free (&transposeGroup);
+        }
+    }
+    if (opts.hierColl) {
+        TopoHierFree (&hier_row);
+        TopoHierFree (&hier_colm);
+    }
+
+    delete [] vectorCur;
+    delete [] vectorResult;
+    if (opts.sharedVector) {
+        SharedVectorFree (&shVect);
+    } else {
+        delete [] vectorPast;
+    }
+
+    MPI_Type_free (&vectType);
+}
+
+/*==============================================================================
+ *  DistributedMatrix::CreateComms
+ *=============================================================================*/
+
+void DistributedMatrix::CreateComms () {
+
+    int size[2];
+
+    DLOG (C_VERBOSE, "Node[%d] creating cartesian grid\n", myRank);
+    size[0] = gridDim;
+    size[1] = gridDim;
+    int periodic[2] = {0,0};/* no wrapping around */
+
+    /*
+     * MPI implementations mostly ignore the reorder flag, so the host aware placement is done here
+     * by ordering the ranks of a communicator with their grid position & creating the grid without reordering.
+     * The placement keeps rank 0 at (0,0).
+     */
+    gridRank = myRank;
+    MPI_Comm order_comm = comm;
+    if (opts.hierColl) {
+        DLOG (C_VERBOSE, "Node[%d] placing the ranks of every host on a tile of the grid\n", myRank);
+        TopoGridOrder (comm, size[0], &gridRank);
+        MPI_Comm_split (comm, 0, gridRank, &order_comm);
+    }
+
+    /* 
+     * Create virtual grid
+     * arg1 - old Communicator from which the new communicator is created
+     * arg2 - Number of dimensions of the cartesian topology,
+     * arg3 - grid size in each dimension
+     * arg4 - periodicity in each dimension;this is used to deal with elements on the boundaries
+     * arg5 - 1=reorder processes, 0=do not reorder processes
+     * arg6 - the new cartesian grid communicator
+     * */
+    MPI_Cart_create (order_comm, TWO_DIMENSION, size, periodic, NO_REORDER, &grid_comm);
+    /* this function gives the coordinates of the node in the 2D grid */
+    MPI_Cart_coords (grid_comm, gridRank, TWO_DIMENSION, grid_coords);
+
+    if (order_comm != comm) {
+        MPI_Comm_free (&order_comm);
+    }
+
+    DLOG (C_VERBOSE, "Node[%d] creating row & column communicators\n", myRank);
+    MPI_Comm_split (grid_comm, grid_coords[1], grid_coords[0], &comm_colm); 
+    MPI_Comm_split (grid_comm, grid_coords[0], grid_coords[1], &comm_row);
+
+    MPI_Comm_rank(comm_row, &rowRank);
+    MPI_Comm_rank(comm_colm, &colmRank);
+
+    DLOG (C_VERBOSE, "Node[%d] gridRank = %d. grid_coords[0] = %d grid_coords[1] = %d "
+            "rowRank = %d colmRank = %d\n", myRank, gridRank, grid_coords[0], grid_coords[1], rowRank, colmRank );
+}
+
+/*==============================================================================
+ *  DistributedMatrix::CreateTranspose
+ *=============================================================================*/
+
+void DistributedMatrix::CreateTranspose () {
+
+    int coords[2];
+
+    /*
+     * in the RMA mode the 1st row nodes expose vectorResult in a window & the 1st column nodes put their
+     * reduced result straight into it. The target posts its exposure epoch at the start of the iteration,
+     * so the put goes out as soon as the reduction is done without waiting for a matching receive.
+     */
+    isTransposeOrigin = (grid_coords[1] == 0 && grid_coords[0] != 0);
+    isTransposeTarget = (grid_coords[0] == 0 && grid_coords[1] != 0);
+    transposeRank = MPI_PROC_NULL;
+    resultWin = MPI_WIN_NULL;
+    transposeGroup = MPI_GROUP_NULL;
+
+    /* peer of the transpose, (0,i) for the node (i,0) & the other way round */
+    if (isTransposeOrigin || isTransposeTarget) {
+        coords[0] = isTransposeOrigin ? 0 : grid_coords[1];
+        coords[1] = isTransposeOrigin ? grid_coords[0] : 0;
+        MPI_Cart_rank (grid_comm, coords, &transposeRank);
+    }
+
+    if (opts.rmaTranspose) {
+        DLOG (C_VERBOSE, "Node[%d] creating window for the result vector\n", myRank);
+        MPI_Win_create (vectorResult, isTransposeTarget ? subVecColmSize * sizeof(matElem_t) : 0,
+                sizeof(matElem_t), MPI_INFO_NULL, grid_comm, &resultWin);
+
+        if (isTransposeOrigin || isTransposeTarget) {
+            MPI_Group gridGroup;
+
+            MPI_Comm_group (grid_comm, &gridGroup);
+            MPI_Group_incl (gridGroup, 1, &transposeRank, &transposeGroup);
+            MPI_Group_free (&gridGroup);
+        }
+    }
+}
+
+/*==============================================================================
+ *  DistributedMatrix::CreatePlan
+ *=============================================================================*/
+
+void DistributedMatrix::CreatePlan () {
+
+    /*
+     * the buffers, counts & communicators are the same in every iteration, so the persistent
+     * requests are bound to them once here. Steps done by the two level, shared memory or RMA
+     * modes keep their own calls.
+     */
+    plan.reduce = plan.transpose = plan.bcast = MPI_REQUEST_NULL;
+    plan.gather[0] = plan.gather[1] = MPI_REQUEST_NULL;
+
+    if (!opts.persistComm) {
+        return;
+    }
+
+    DLOG (C_VERBOSE, "Node[%d] creating persistent requests, MPI version %d.%d\n", myRank, MPI_VERSION, MPI_SUBVERSION);
+
+    if (!opts.rmaTranspose && isTransposeOrigin) {
+        MPI_Send_init (vectorResult, subMatRowSize, MAT_ELEM_MPI_TYPE, transposeRank, VECTOR_COLUMN_RESULT, grid_comm,
+                &plan.transpose);
+    } else if (!opts.rmaTranspose && isTransposeTarget) {
+        MPI_Recv_init (vectorResult, 1, vectType, transposeRank, VECTOR_COLUMN_RESULT, grid_comm, &plan.transpose);
+    }
+
+#if (PERSISTENT_COLL)
+    if (!opts.hierColl) {
+        MPI_Reduce_init (vectorCur, vectorResult, subMatRowSize, MAT_ELEM_MPI_TYPE, vectSumOp, NODE_0, comm_row,
+                MPI_INFO_NULL, &plan.reduce);
+    }
+    if (!opts.hierColl && !opts.sharedVector) {
+        MPI_Bcast_init (vectorResult, 1, vectType, NODE_0, comm_colm, MPI_INFO_NULL, &plan.bcast);
+    }
+    if (grid_coords[0] == 0) {
+        /* X is in one of the two slots of the shared window, or always in vectorPast, where curSlot stays 0 */
+        int numSlots = opts.sharedVector ? 2 : 1;
+
+        for (int slot = 0; slot < numSlots; slot++) {
+            matElem_t * gatherBuf = opts.sharedVector ? shVect.slot[slot] : vectorPast;
+
+            MPI_Gatherv_init (gatherBuf, 1, vectType, vectorFinalResult, segCounts, partition, MAT_ELEM_MPI_TYPE,
+                    NODE_0, comm_row, MPI_INFO_NULL, &plan.gather[slot]);
+        }
+    }
+#endif
+}
+
+/*==============================================================================
+ *  DistributedMatrix::Destroy
+ *=============================================================================*/
+
+void DistributedMatrix::Destroy () {
+
+    if (!created) {
+        return;
+    }
+
+    if ( myRank == NODE_0) {
+        delete [] vectorFinalResult;
+    }
+
+    FreeLayout ();
+
+    FreeMatrix (matrix, matrixBytes);
+    FreeBlockStructure (&blockShape);
+    delete [] partition;
+    delete [] segCounts;
+    delete [] blockRates;
+
+    MPI_Comm_free (&comm_node);
+    MPI_Comm_free (&grid_comm);
+    MPI_Comm_free (&comm_row);
+    MPI_Comm_free (&comm_colm);
+
+#if (MOD_ARITH)
+    MPI_Op_free (&vectSumOp);
+#endif
+
+    created = 0;
+}
+
+/*==============================================================================
+ *  DistributedMatrix::SetOptions
+ *=============================================================================*/
+
+CStatus DistributedMatrix::SetOptions (const MatMulOptions &optsIn) {
+
+    if (!created) {
+        return C_INVALID_HANDLE;
+    }
+
+    /* the placement decides where the block of A lives, changing it would mean building A again */
+    if (optsIn.pinRanks != opts.pinRanks || optsIn.hugePage != opts.hugePage || optsIn.hierColl != opts.hierColl) {
+        return C_UNSUPPORTED;
+    }
+
+    FreeLayout ();
+
+    opts = optsIn;
+    if (numprocs == 1) {
+        opts.rmaTranspose = 0;
+    }
+    computeTime = 0;
+    balanceSteps = 0;
+
+    CreateLayout ();
+    return C_SUCCESS;
+}
+
+/*==============================================================================
+ *  DistributedMatrix::Iterate
+ *=============================================================================*/
+
+CStatus DistributedMatrix::Iterate (matElem_t *x, int k) {
+
+    if (!created) {
+        return C_INVALID_HANDLE;
+    }
+
+    /*
+     * the arguments are checked together, so that a bad x at rank 0 or a k that differs
+     * between the ranks fails on every rank instead of leaving the others in the collectives
+     */
+    int check[3];
+    check[0] = (k >= 0 && (myRank != NODE_0 || x != NULL));
+    check[1] = k;
+    check[2] = (k >= 0) ? -k : 0;
+    MPI_Allreduce (MPI_IN_PLACE, check, 3, MPI_INT, MPI_MIN, comm);
+    if (!check[0] || check[1] != -check[2]) {
+        DLOG (C_ERROR, "Node[%d] invalid x or k on some of the ranks\n", myRank);
+        return C_INVALID_ARGS;
+    }
+
+    Distribute (x);
+
+    for (int i = 0; i < k; i++) {
+        Step ();
+
+        if (opts.balanceInterval > 0 && ++balanceSteps == opts.balanceInterval) {
+
+            int * newPartition = new int [gridDim + 1];
+
+            /* X is collected with the old blocks & handed out again with the new ones */
+            balanceSteps = 0;
+            if (PlanBalance (newPartition)) {
+                Collect (x);
+                Rebalance (newPartition);
+                Distribute (x);
+            }
+            delete [] newPartition;
+        }
+    }
+
+    Collect (x);
+    return C_SUCCESS;
+}
+
+/*==============================================================================
+ *  DistributedMatrix::PlanBalance
+ *=============================================================================*/
+
+int DistributedMatrix::PlanBalance (int *newPartition) {
+
+    double * reports = NULL;
+    double report[BALANCE_REPORT];
+    int perColm;
+
+    if ( myRank == NODE_0) {
+        reports = new double [numprocs * BALANCE_REPORT];
+    }
+
+    /* the time is compared with the work the kernel of the block does, not with its area */
+    report[0] = computeTime;
+    report[1] = BlockWork (&blockShape, subMatRowSize, subMatColmSize, &perColm);
+    report[2] = perColm;
+
+    /* rank 0 of comm is rank 0 of the grid, whose ranks are in row major order of the blocks */
+    DLOG (C_VERBOSE, "Node[%d] gathering the compute time of the blocks\n", myRank);
+    MPI_Gather (report, BALANCE_REPORT, MPI_DOUBLE, reports, BALANCE_REPORT, MPI_DOUBLE, NODE_0, grid_comm);
+    computeTime = 0;
+
+    if ( myRank == NODE_0) {
+        BalancePartition (reports, gridDim, partition, blockRates, newPartition);
+        delete [] reports;
+    }
+    MPI_Bcast (newPartition, gridDim + 1, MPI_INT, NODE_0, grid_comm);
+
+    return (memcmp (newPartition, partition, (gridDim + 1) * sizeof(int)) != 0);
+}
+
+/*==============================================================================
+ *  DistributedMatrix::Rebalance
+ *=============================================================================*/
+
+void DistributedMatrix::Rebalance (const int *newPartition) {
+
+    MigrateMatrix (newPartition);
+
+    /* the vectors, windows & requests are all sized by the segments, so they are set up again */
+    FreeLayout ();
+
+    memcpy (partition, newPartition, (gridDim + 1) * sizeof(int));
+    for (int k = 0; k < gridDim; k++) {
+        segCounts[k] = partition[k + 1] - partition[k];
+    }
+    subMatRowSize = segCounts[grid_coords[0]];
+    subMatColmSize = segCounts[grid_coords[1]];
+    subVecColmSize = subMatColmSize;
+
+    CreateLayout ();
+}
+
+/*==============================================================================
+ *  DistributedMatrix::MigrateMatrix
+ *=============================================================================*/
+
+void DistributedMatrix::MigrateMatrix (const int *newPartition) {
+
+    int coords[2];
+    int rowStart, colmStart, rows, colms;
+    long sendTotal = 0, recvTotal = 0;
+    int numRequests = 0;
+    MPI_Request * requests = new MPI_Request [2 * numprocs];
+    MPI_Datatype * rectTypes = new MPI_Datatype [2 * numprocs];
+
+    /* old & new rows & columns of A held by this node */
+    int oldRow = partition[grid_coords[0]], oldRowEnd = partition[grid_coords[0] + 1];
+    int oldColm = partition[grid_coords[1]], oldColmEnd = partition[grid_coords[1] + 1];
+    int newRow = newPartition[grid_coords[0]], newRowEnd = newPartition[grid_coords[0] + 1];
+    int newColm = newPartition[grid_coords[1]], newColmEnd = newPartition[grid_coords[1] + 1];
+
+    /* the new block is touched first by this node, before the old one is freed */
+    matElem_t ** newMatrix;
+    size_t newMatrixBytes;
+    InitMatrix (&newMatrix, newRowEnd - newRow, newColmEnd - newColm, newRow, newColm, NULL_MATRIX,
+            opts.hugePage, &newMatrixBytes);
+
+    /*
+     * every node sends the part of its old block lying in the new block of the other node, a rectangle
+     * of A described by a subarray type of the old & the new block, so it moves without a staging copy
+     */
+    for (int g = 0; g < numprocs; g++) {
+
+        if (g == gridRank) {
+            continue;
+        }
+        MPI_Cart_coords (grid_comm, g, TWO_DIMENSION, coords);
+
+        rows = RangeOverlap (partition[coords[0]], partition[coords[0] + 1], newRow, newRowEnd, &rowStart);
+        colms = RangeOverlap (partition[coords[1]], partition[coords[1] + 1], newColm, newColmEnd, &colmStart);
+        if (rows > 0 && colms > 0) {
+            BlockRectType (newRowEnd - newRow, newColmEnd - newColm, rowStart - newRow, colmStart - newColm,
+                    rows, colms, &rectTypes[numRequests]);
+            MPI_Irecv (newMatrix[0], 1, rectTypes[numRequests], g, MIGRATE_MATRIX_TAG, grid_comm, &requests[numRequests]);
+            numRequests++;
+            recvTotal += (long) rows * colms;
+        }
+
+        rows = RangeOverlap (oldRow, oldRowEnd, newPartition[coords[0]], newPartition[coords[0] + 1], &rowStart);
+        colms = RangeOverlap (oldColm, oldColmEnd, newPartition[coords[1]], newPartition[coords[1] + 1], &colmStart);
+        if (rows > 0 && colms > 0) {
+            BlockRectType (oldRowEnd - oldRow, oldColmEnd - oldColm, rowStart - oldRow, colmStart - oldColm,
+                    rows, colms, &rectTypes[numRequests]);
+            MPI_Isend (matrix[0], 1, rectTypes[numRequests], g, MIGRATE_MATRIX_TAG, grid_comm, &requests[numRequests]);
+            numRequests++;
+            sendTotal += (long) rows * colms;
+        }
+    }
+
+    DLOG (C_VERBOSE, "Node[%d] migrating the block of A, sending %ld & receiving %ld elements\n", myRank, sendTotal, recvTotal);
+
+    /* the part of the old block this node keeps is copied while the messages are in flight */
+    rows = RangeOverlap (oldRow, oldRowEnd, newRow, newRowEnd, &rowStart);
+    colms = RangeOverlap (oldColm, oldColmEnd, newColm, newColmEnd, &colmStart);
+    for (int i = 0; i < rows && colms > 0; i++) {
+        memcpy (&newMatrix[rowStart + i - newRow][colmStart - newColm], &matrix[rowStart + i - oldRow][colmStart - oldColm],
+                (size_t) colms * sizeof(matElem_t));
+    }
+
+    MPI_Waitall (numRequests, requests, MPI_STATUSES_IGNORE);
+    for (int r = 0; r < numRequests; r++) {
+        MPI_Type_free (&rectTypes[r]);
+    }
+    delete [] requests;
+    delete [] rectTypes;
+
+    FreeMatrix (matrix, matrixBytes);
+    matrix = newMatrix;
+    matrixBytes = newMatrixBytes;
+
+    FreeBlockStructure (&blockShape);
+    ClassifyBlock (matrix, newRowEnd - newRow, newColmEnd - newColm, &blockShape);
+    DLOG (C_VERBOSE, "Node[%d] block (%d,%d) of A is now %d x %d of kind %d\n", myRank, grid_coords[0], grid_coords[1],
+            newRowEnd - newRow, newColmEnd - newColm, blockShape.kind);
+}
+
+/*==============================================================================
+ *  DistributedMatrix::Multiply
+ *=============================================================================*/
+
+CStatus DistributedMatrix::Multiply (matElem_t *x) {
+
+    return Iterate (x, 1);
+}
+
+/*==============================================================================
+ *  DistributedMatrix::Distribute
+ *=============================================================================*/
+
+void DistributedMatrix::Distribute (const matElem_t *x) {
+
+    /*
+     * scatter the columns of X to the first row nodes and broadcast them
+     */
+    if ( grid_coords[0] == 0) {
+        DLOG (C_VERBOSE, "Node[%d] is a leader! receiving its columns of the vector\n", myRank);
+        MPI_Scatterv (x, segCounts, partition, MAT_ELEM_MPI_TYPE, vectorPast, 1, vectType, NODE_0, comm_row);
+#if (DEBUG)
+        DLOG (C_VERBOSE, "Node[%d] Printing vectorPast\n", myRank);
+        printVector (vectorPast, subVecColmSize);
+#endif
+    }
+
+    if (opts.sharedVector) {
+
+        /* only the host leaders of the column take part in the broadcast, straight into the shared copy */
+        if (shVect.comm_colm_leaders != MPI_COMM_NULL) {
+            DLOG (C_VERBOSE, "Node[%d] broadcasting the initial vector to the other hosts\n", myRank);
+            MPI_Bcast (vectorPast, 1, vectType, NODE_0, shVect.comm_colm_leaders);
+        }
+        SharedVectorSync (&shVect, comm_node);
+
+    } else if (opts.hierColl) {
+        DLOG (C_VERBOSE, "Node[%d] broadcasting the initial vector within the hosts\n", myRank);
+        TopoHierBcast (vectorPast, 1, vectType, &hier_colm);
+
+    } else {
+        DLOG (C_VERBOSE, "Node[%d] broadcasting the initial vector\n", myRank);
+        MPI_Bcast (vectorPast, 1, vectType, NODE_0, comm_colm);
+    }
+
+#if (DEBUG)
+    DLOG (C_VERBOSE, "Node[%d] Printing vectorPast\n", myRank);
+    printVector (vectorPast, subVecColmSize);
+#endif
+}
+
+/*==============================================================================
+ *  DistributedMatrix::Step
+ *=============================================================================*/
+
+void DistributedMatrix::Step () {
+
+    if (opts.rmaTranspose && isTransposeTarget) {
+        DLOG (C_VERBOSE, "Node[%d] exposing vectorResult to node[%d]\n", myRank, transposeRank);
+        MPI_Win_post (transposeGroup, 0, resultWin);
+    }
+
+    double computeStart = MPI_Wtime ();
+
+    /* a zero block adds nothing to the row sum, its vectorCur stays 0 from CreateLayout */
+    if (blockShape.kind == BLOCK_DENSE) {
+#if (MOD_ARITH)
+        DLOG (C_VERBOSE, "Node[%d] computing matrix-vector multiplication mod %llu\n", myRank, (unsigned long long) (MOD_PRIME));
+        MatVecMod (matrix, vectorPast, vectorCur, subMatRowSize, subMatColmSize, opts.tileSize);
+#else
+        DLOG (C_VERBOSE, "Node[%d] computing matrix-vector multiplication\n", myRank);
+        MatVec (matrix, vectorPast, vectorCur, subMatRowSize, subMatColmSize, opts.tileSize);
+#endif
+    } else if (blockShape.kind != BLOCK_ZERO) {
+        DLOG (C_VERBOSE, "Node[%d] computing matrix-vector multiplication of a block of kind %d\n", myRank, blockShape.kind);
+        MatVecStructured (&blockShape, matrix, vectorPast, vectorCur, subMatRowSize, subMatColmSize);
+    }
+
+    computeTime += MPI_Wtime () - computeStart;
+#if (DEBUG)
+    DLOG (C_VERBOSE, "Node[%d] Printing vectorCur\n", myRank);
+    printVector (vectorCur, subMatRowSize);
+#endif
+
+    /*
+     * reduce the multiplication result at leader node of row communicators 
+     */
+    DLOG (C_VERBOSE, "Node[%d] Reducing the vector result at NODE_0 of row communicators\n", myRank);
+    if (opts.hierColl) {
+        TopoHierReduce (vectorCur, vectorResult, subMatRowSize, MAT_ELEM_MPI_TYPE, vectSumOp, &hier_row);
+    } else if (plan.reduce != MPI_REQUEST_NULL) {
+        CommPlanRun (&plan.reduce);
+    } else {
+        MPI_Reduce(vectorCur, vectorResult, subMatRowSize, MAT_ELEM_MPI_TYPE, vectSumOp, NODE_0, comm_row);
+    }
+
+#if (DEBUG)
+    DLOG (C_VERBOSE, "Node[%d] Printing vectorResult\n", myRank);
+    printVector (vectorResult, subMatRowSize);
+#endif
+
+    /*
+     * row leaders send result to the column leaders
+     */
+    if (opts.rmaTranspose) {
+
+        if (isTransposeOrigin) {
+            DLOG (C_VERBOSE, "Node[%d] putting result to node[%d]\n", myRank, transposeRank);
+            MPI_Win_start (transposeGroup, 0, resultWin);
+            MPI_Put (vectorResult, subMatRowSize, MAT_ELEM_MPI_TYPE, transposeRank, 0, subMatRowSize, MAT_ELEM_MPI_TYPE,
+                    resultWin);
+            MPI_Win_complete (resultWin);
+        } else if (isTransposeTarget) {
+            DLOG (C_VERBOSE, "Node[%d] waiting for the result from node[%d]\n", myRank, transposeRank);
+            MPI_Win_wait (resultWin);
+        }
+
+    } else if (plan.transpose != MPI_REQUEST_NULL) {
+
+        DLOG (C_VERBOSE, "Node[%d] exchanging result with node[%d]\n", myRank, transposeRank);
+        CommPlanRun (&plan.transpose);
+
+    } else if (isTransposeOrigin) {/* if 1st column node then send the result to corrsponding 1st row node */
+
+        DLOG (C_VERBOSE, "Node[%d] sending result to node[%d]\n", myRank, transposeRank);
+        MPI_Send (vectorResult, subMatRowSize, MAT_ELEM_MPI_TYPE, transposeRank, VECTOR_COLUMN_RESULT, grid_comm);
+
+    } else if (isTransposeTarget) {/* if 1st row node then receive the result from the corrsponding 1st column node */
+
+        DLOG (C_VERBOSE, "Node[%d] receiving result from node[%d]\n", myRank, transposeRank);
+        MPI_Recv (vectorResult, 1, vectType, transposeRank, VECTOR_COLUMN_RESULT, grid_comm, MPI_STATUS_IGNORE );
+    }
+
+    if (opts.sharedVector) {
+
+        matElem_t * vectorNext = shVect.slot[1 - curSlot];
+
+        if (shVect.comm_colm_leaders != MPI_COMM_NULL) {
+            DLOG (C_VERBOSE, "Node[%d] broadcasting the result to the other hosts of the column\n", myRank);
+
+            if (colmRank == NODE_0) {
+                memcpy (vectorNext, vectorResult, subVecColmSize * sizeof(matElem_t));
+            }
+            MPI_Bcast (vectorNext, 1, vectType, NODE_0, shVect.comm_colm_leaders);
+        }
+
+        /* 
+         * the other slot is still read by ranks computing this iteration, the sync after
+         * writing it orders these writes with those reads & the next iteration's reads
+         */
+        DLOG (C_VERBOSE, "Node[%d] waiting for the shared vector\n", myRank);
+        SharedVectorSync (&shVect, comm_node);
+        curSlot = 1 - curSlot;
+        vectorPast = vectorNext;
+
+    } else {
+        DLOG (C_VERBOSE, "Node[%d] broadcasting the result to column communicators\n", myRank);
+
+        if (opts.hierColl) {
+            TopoHierBcast (vectorResult, 1, vectType, &hier_colm);
+        } else if (plan.bcast != MPI_REQUEST_NULL) {
+            CommPlanRun (&plan.bcast);
+        } else {
+            MPI_Bcast (vectorResult, 1, vectType, NODE_0, comm_colm);
+        }
+
+        DLOG (C_VERBOSE, "Node[%d] copying vectorResult to vectorPast \n", myRank);
+
+        memcpy ( vectorPast, vectorResult, subVecColmSize * sizeof(matElem_t));
+    }
+
+#if (DEBUG)
+    if (grid_coords[1] == 0 ) {
+        DLOG (C_VERBOSE, "Node[%d] Printing vectorPast \n", myRank);
+        printVector (vectorPast, subVecColmSize);
+    }
+#endif
+}
+
+/*==============================================================================
+ *  DistributedMatrix::Collect
+ *=============================================================================*/
+
+void DistributedMatrix::Collect (matElem_t *x) {
+
+    /* the first row nodes hold the columns of X in order of their row rank */
+    if (grid_coords[0] == 0) {
+
+        DLOG (C_VERBOSE, "Node[%d] gathering result at node 0\n", myRank);
+        if (plan.gather[curSlot] != MPI_REQUEST_NULL) {
+            CommPlanRun (&plan.gather[curSlot]);
+        } else {
+            MPI_Gatherv (vectorPast, 1, vectType, vectorFinalResult, segCounts, partition, MAT_ELEM_MPI_TYPE,
+                    NODE_0, comm_row);
+        }
+    }
+
+    if (myRank == NODE_0) {
+        memcpy (x, vectorFinalResult, matSize * sizeof(matElem_t));
+#if (DEBUG)
+        DLOG (C_VERBOSE, "Node[%d] Printing vectorFinalResult of the multiplication\n", myRank);
+        printVector (vectorFinalResult, matSize);
+#endif
+    }
+}
+
+/*==============================================================================
+ *  DefaultOptions
+ *=============================================================================*/
+
+void DefaultOptions (MatMulOptions *opts) {
+
+    opts->pinRanks = 0;
+    opts->hugePage = HUGE_PAGE_NONE;
+    opts->sharedVector = 0;
+    opts->hierColl = 0;
+    opts->rmaTranspose = 0;
+    opts->persistComm = 0;
+    opts->tileSize = 0;
+    opts->balanceInterval = 0;
+}
+
+/*==============================================================================
+ *  RangeOverlap
+ *=============================================================================*/
+
+static int RangeOverlap (int start1, int end1, int start2, int end2, int *start) {
+
+    int end = (end1 < end2) ? end1 : end2;
+
+    *start = (start1 > start2) ? start1 : start2;
+    return (end > *start) ? end - *start : 0;
+}
+
+/*==============================================================================
+ *  BlockRectType
+ *=============================================================================*/
+
+static void BlockRectType (int blockRows, int blockColms, int rowStart, int colmStart, int rows, int colms, MPI_Datatype *rectType) {
+
+    int sizes[2] = { blockRows, blockColms };
+    int subSizes[2] = { rows, colms };
+    int starts[2] = { rowStart, colmStart };
+
+    MPI_Type_create_subarray (TWO_DIMENSION, sizes, subSizes, starts, MPI_ORDER_C, MAT_ELEM_MPI_TYPE, rectType);
+    MPI_Type_commit (rectType);
+}
+
+/*==============================================================================
+ *  BlockWork
+ *=============================================================================*/
+
+static double BlockWork (const BlockStructure *shape, int rows, int colms, int *perColm) {
+
+    double work = 0;
+
+    /* the diagonal & banded kernels run over the rows & the band, their work grows with the rows only */
+    *perColm = 0;
+
+    if (shape->kind == BLOCK_DIAGONAL) {
+        work = (rows < colms) ? rows : colms;
+
+    } else if (shape->kind == BLOCK_BANDED) {
+        /* the diagonal j - i = d holds the rows max(0, -d) ... min(rows, colms - d) - 1 */
+        for (int d = shape->bandLow; d <= shape->bandHigh; d++) {
+            int start = (d < 0) ? -d : 0;
+            int end = (colms - d < rows) ? colms - d : rows;
+
+            work += (end > start) ? end - start : 0;
+        }
+
+    } else if (shape->kind != BLOCK_ZERO) {
+        work = (double) rows * colms;
+        *perColm = 1;
+    }
+    return work;
+}
+
+/*==============================================================================
+ *  PredictTime
+ *=============================================================================*/
+
+/*
+ * time of the slowest block if the segments of X had the given sizes. cost is the time of a block
+ * per row, or per element if perColm is set, & is assumed to stay the same as the block is resized.
+ */
+static double PredictTime (const double *cost, const int *perColm, int gridDim, const int *counts) {
+
+    double slowest = 0;
+
+    for (int r = 0; r < gridDim; r++) {
+        for (int c = 0; c < gridDim; c++) {
+            int k = r * gridDim + c;
+            double blockTime = cost[k] * counts[r] * (perColm[k] ? counts[c] : 1);
+
+            slowest = (blockTime > slowest) ? blockTime : slowest;
+        }
+    }
+    return slowest;
+}
+
+/*==============================================================================
+ *  BalancePartition
+ *=============================================================================*/
+
+static void BalancePartition (const double *reports, int gridDim, const int *partition, double *rates, int *newPartition) {
+
+    int r, c, k;
+    int matSize = partition[gridDim];
+    int numBlocks = gridDim * gridDim;
+    double maxTime = 0, sumTime = 0, maxRate = 0;
+    double * cost = new double [numBlocks];
+    int * perColm = new int [numBlocks];
+    int * counts = new int [gridDim];
+
+    memcpy (newPartition, partition, (gridDim + 1) * sizeof(int));
+
+    /*
+     * time per element of work of every block, the work being what its kernel multiplies, so a diagonal
+     * block is not charged for its area. The speed is a property of the rank, so it is averaged over
+     * the checks to ride out the noise.
+     */
+    for (r = 0; r < gridDim; r++) {
+        for (c = 0; c < gridDim; c++) {
+
+            k = r * gridDim + c;
+            double blockTime = reports[k * BALANCE_REPORT];
+            double work = reports[k * BALANCE_REPORT + 1];
+
+            if (work > 0) {
+                double measured = blockTime / work;
+                rates[k] = (rates[k] < 0) ? measured : BALANCE_SMOOTHING * rates[k] + (1.0 - BALANCE_SMOOTHING) * measured;
+                maxRate = (rates[k] > maxRate) ? rates[k] : maxRate;
+            }
+            maxTime = (blockTime > maxTime) ? blockTime : maxTime;
+            sumTime += blockTime;
+        }
+    }
+
+    /*
+     * the cost of a block per row or per element at its current size. Blocks that cost next to
+     * nothing, e.g. zero blocks, still should not get all of A, they are costed as dense blocks
+     * at the lowest rate.
+     */
+    for (r = 0; r < gridDim; r++) {
+        for (c = 0; c < gridDim; c++) {
+
+            k = r * gridDim + c;
+            double work = reports[k * BALANCE_REPORT + 1];
+            double rows = partition[r + 1] - partition[r];
+            double rate = (rates[k] > maxRate * BALANCE_MIN_RATE) ? rates[k] : maxRate * BALANCE_MIN_RATE;
+
+            perColm[k] = (int) reports[k * BALANCE_REPORT + 2];
+            if (work <= 0) {
+                perColm[k] = 1;
+                cost[k] = maxRate * BALANCE_MIN_RATE;
+            } else if (perColm[k]) {
+                cost[k] = rate * work / (rows * (partition[c + 1] - partition[c]));
+            } else {
+                cost[k] = rate * work / rows;
+            }
+        }
+    }
+
+    if (maxTime <= 0 || maxTime <= BALANCE_TOLERANCE * sumTime / numBlocks) {
+        DLOG (C_VERBOSE, "compute time of the blocks within %g of the mean, keeping the blocks\n", (double) (BALANCE_TOLERANCE));
+        delete [] cost;
+        delete [] perColm;
+        delete [] counts;
+        return;
+    }
+
+    for (k = 0; k < gridDim; k++) {
+        counts[k] = partition[k + 1] - partition[k];
+    }
+
+    /*
+     * the segment k sets the size of all the blocks of grid row k & grid column k, so the segments
+     * can not be sized one by one. Rows are moved from one segment to another as long as that
+     * speeds up the slowest block, in steps halved down to a single row.
+     */
+    double curTime = PredictTime (cost, perColm, gridDim, counts);
+    double bestTime = curTime;
+    int step = (matSize / (2 * gridDim) > 1) ? matSize / (2 * gridDim) : 1;
+
+    while (step > 0) {
+
+        int bestFrom = -1, bestTo = -1;
+        double moveTime = bestTime;
+
+        for (int from = 0; from < gridDim; from++) {
+            for (int to = 0; to < gridDim; to++) {
+
+                if (from == to || counts[from] - step < 1) {
+                    continue;
+                }
+
+                counts[from] -= step;
+                counts[to] += step;
+                double trialTime = PredictTime (cost, perColm, gridDim, counts);
+                counts[from] += step;
+                counts[to] -= step;
+
+                if (trialTime < moveTime) {
+                    moveTime = trialTime;
+                    bestFrom = from;
+                    bestTo = to;
+                }
+            }
+        }
+
+        if (bestFrom < 0) {
+            step /= 2;
+            continue;
+        }
+        counts[bestFrom] -= step;
+        counts[bestTo] += step;
+        bestTime = moveTime;
+    }
+
+    /* moving A is not free, small gains are not worth it */
+    if (bestTime <= curTime * (1.0 - BALANCE_MIN_GAIN) && curTime - bestTime >= BALANCE_MIN_SAVING) {
+        DLOG (C_INFO, "rebalancing the blocks, slowest block %g s predicted to drop to %g s\n", curTime, bestTime);
+        for (k = 0; k < gridDim; k++) {
+            newPartition[k + 1] = newPartition[k] + counts[k];
+        }
+    }
+
+    delete [] cost;
+    delete [] perColm;
+    delete [] counts;
+}
+
+/*==============================================================================
+ *  InitMatrix
+ *=============================================================================*/
+
+void InitMatrix (matElem_t *** matCur, int matRowSize, int matColmSize, int rowOffset, int colmOffset,
+        int indexValue, int hugePage, size_t *mappedBytes) {
+
+    int i;
+    matElem_t ** matrix = new matElem_t * [matRowSize];
+
+    (*matCur) = matrix;
+    int  myWorldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myWorldRank);
+
+    DLOG (C_VERBOSE, "Node[%d] Enter\n", myWorldRank);
+
+    /* the rows are laid out back to back in one block so that it can be backed with huge pages */
+    matElem_t * block = (matElem_t *) TopoAllocBlock ((size_t) matRowSize * matColmSize * sizeof(matElem_t),
+            hugePage, mappedBytes);
+    if (block == NULL) {
+        CLOG_ASSERT_ERR ("block == NULL", "could not allocate the matrix", C_MALLOC_FAILED);
+        MPI_Abort (MPI_COMM_WORLD, C_MALLOC_FAILED);
+    }
+
+    for (i = 0; i < matRowSize; i++){
+        matrix[i] = block + (size_t) i * matColmSize;
+    }
+
+    FillMatrix (matrix, matRowSize, matColmSize, rowOffset, colmOffset, indexValue);
+
+    DLOG (C_VERBOSE, "Node[%d] Exit\n", myWorldRank);
+}
+
+
+/*==============================================================================
+ *  FillMatrix
+ *=============================================================================*/
+
+void FillMatrix (matElem_t **matrix, int matRowSize, int matColmSize, int rowOffset, int colmOffset, int indexValue) {
+
+    int i,j;
+    /* row & column of the block element matrix[i][j] in A */
+    long row, colm;
+
+    if (indexValue == 0) {
+        /* set the array elements to 0, use memset */
+
+        for (i = 0; i < matRowSize ; i++ ) {
+            for ( j = 0; j < matColmSize ; j++ ) {
+                matrix[i][j] = 0; 
+            }
+        }
+
+    } else if (indexValue == IDENTITY_MATRIX) {
+        /* identity matix */
+
+        for (i = 0; i < matRowSize ; i++ ) {
+            for ( j = 0; j < matColmSize ; j++ ) {
+
+                row = (long) rowOffset + i;
+                colm = (long) colmOffset + j;
+
+                if ( row == colm) {
+                    matrix[i][j] = 1; 
+                } else {
+                    matrix[i][j] = 0; 
+                }
+
+
+            }
+        }
+
+    } else if (indexValue == SPARSE_MATRIX) {
+        /* sparse matrix  */
+        for (i = 0; i < matRowSize ; i++ ) {
+            for ( j = 0; j < matColmSize ; j++ ) {
+
+                row = (long) rowOffset + i;
+                colm = (long) colmOffset + j;
+
+                if ( (row+colm) % 2 == 0) {
+                    matrix[i][j] = 1; 
+                } else {
+                    matrix[i][j] = 0; 
+                }
+            }
+        }
+
+    } else if (indexValue == BANDED_MATRIX) {
+        /* tridiagonal matrix, 2 on the diagonal & 1 next to it */
+        for (i = 0; i < matRowSize ; i++ ) {
+            for ( j = 0; j < matColmSize ; j++ ) {
+
+                row = (long) rowOffset + i;
+                colm = (long) colmOffset + j;
+
+                if ( row == colm) {
+                    matrix[i][j] = 2; 
+                } else if ( row - colm == 1 || colm - row == 1) {
+                    matrix[i][j] = 1; 
+                } else {
+                    matrix[i][j] = 0; 
+                }
+            }
+        }
+
+    } else if (indexValue == DENSE_MATRIX) {
+        /* values 0 ... 10 with no structure, every block is multiplied by the dense kernel */
+        for (i = 0; i < matRowSize ; i++ ) {
+            for ( j = 0; j < matColmSize ; j++ ) {
+
+                row = (long) rowOffset + i;
+                colm = (long) colmOffset + j;
+
+                matrix[i][j] = (matElem_t) ((row * 31 + colm * 17) % 11);
+            }
+        }
+
+    }
+}
+
+
+/*==============================================================================
+ *  FreeMatrix
+ *=============================================================================*/
+
+void FreeMatrix (matElem_t ** matCur, size_t mappedBytes) {
+
+    TopoFreeBlock (matCur[0], mappedBytes);
+    delete [] matCur;
+}
+
+
+/*==============================================================================
+ *  ClassifyBlock
+ *=============================================================================*/
+
+void ClassifyBlock (matElem_t **mat, int rows, int colms, BlockStructure *shape) {
+
+    int i, j;
+    int nonZero = 0;
+    int isToeplitz = 1;
+    /* lowest & highest diagonal j - i holding a non zero */
+    int bandLow = colms;
+    int bandHigh = -rows;
+
+    shape->kind = BLOCK_DENSE;
+    shape->bandLow = 0;
+    shape->bandHigh = 0;
+    shape->diags = NULL;
+
+    /* a single pass over the block, it is done only when the block is created or migrated */
+    for (i = 0; i < rows; i++) {
+        for (j = 0; j < colms; j++) {
+
+            if (mat[i][j] != 0) {
+                nonZero = 1;
+                bandLow = (j - i < bandLow) ? j - i : bandLow;
+                bandHigh = (j - i > bandHigh) ? j - i : bandHigh;
+            }
+            if (i > 0 && j > 0 && mat[i][j] != mat[i - 1][j - 1]) {
+                isToeplitz = 0;
+            }
+        }
+    }
+
+    if (!nonZero) {
+        shape->kind = BLOCK_ZERO;
+
+    } else if (bandLow == 0 && bandHigh == 0) {
+        shape->kind = BLOCK_DIAGONAL;
+
+    } else if (bandHigh - bandLow + 1 < colms) {
+        /* cheaper than the dense loop as long as some diagonal of every row is skipped */
+        shape->kind = BLOCK_BANDED;
+        shape->bandLow = bandLow;
+        shape->bandHigh = bandHigh;
+
+    } else if (isToeplitz) {
+        /* the 1st column bottom up followed by the 1st row, so a row of the block is a contiguous run of it */
+        shape->kind = BLOCK_TOEPLITZ;
+        shape->diags = new matElem_t [rows + colms - 1];
+        for (i = 0; i < rows; i++) {
+            shape->diags[rows - 1 - i] = mat[i][0];
+        }
+        for (j = 1; j < colms; j++) {
+            shape->diags[rows - 1 + j] = mat[0][j];
+        }
+    }
+}
+
+/*==============================================================================
+ *  FreeBlockStructure
+ *=============================================================================*/
+
+void FreeBlockStructure (BlockStructure *shape) {
+
+    delete [] shape->diags;
+    shape->diags = NULL;
+}
+
+
+/*==============================================================================
+ *  SharedVectorCreate
+ *=============================================================================*/
+
+static CStatus SharedVectorCreate (SharedVector *shVect, MPI_Comm comm_node, MPI_Comm comm_colm, int vectSize) {
+
+    int colmNodeRank, leaderNodeRank, zeroRank = 0;
+    MPI_Group colmNodeGroup, nodeGroup;
+    MPI_Info info;
+    MPI_Aint segSize;
+    int dispUnit;
+    void * base;
+
+    if (TopoSplitNode (comm_colm, &shVect->comm_colm_node, &shVect->comm_colm_leaders) != C_SUCCESS) {
+        return C_FAILURE;
+    }
+    MPI_Comm_rank (shVect->comm_colm_node, &colmNodeRank);
+
+    /* 
+     * only the host leader of the column allocates the segment, non contiguous allocation lets
+     * every segment be placed on the NUMA node of the leader which first touches it
+     */
+    MPI_Info_create (&info);
+    MPI_Info_set (info, "alloc_shared_noncontig", "true");
+    segSize = (colmNodeRank == 0) ? 2 * (MPI_Aint) vectSize * sizeof(matElem_t) : 0;
+    MPI_Win_allocate_shared (segSize, sizeof(matElem_t), info, comm_node, &base, &shVect->win);
+    MPI_Info_free (&info);
+
+    /* find the rank of the column's host leader in comm_node */
+    MPI_Comm_group (shVect->comm_colm_node, &colmNodeGroup);
+    MPI_Comm_group (comm_node, &nodeGroup);
+    MPI_Group_translate_ranks (colmNodeGroup, 1, &zeroRank, nodeGroup, &leaderNodeRank);
+    MPI_Group_free (&colmNodeGroup);
+    MPI_Group_free (&nodeGroup);
+
+    MPI_Win_shared_query (shVect->win, leaderNodeRank, &segSize, &dispUnit, &base);
+    shVect->slot[0] = (matElem_t *) base;
+    shVect->slot[1] = shVect->slot[0] + vectSize;
+
+    /* the window stays in a passive target epoch, the ranks synchronize with SharedVectorSync */
+    MPI_Win_lock_all (MPI_MODE_NOCHECK, shVect->win);
+    if (colmNodeRank == 0) {
+        memset (base, 0, 2 * (size_t) vectSize * sizeof(matElem_t));
+    }
+
+    return C_SUCCESS;
+}
+
+/*==============================================================================
+ *  SharedVectorSync
+ *=============================================================================*/
+
+static void SharedVectorSync (SharedVector *shVect, MPI_Comm comm_node) {
+
+    MPI_Win_sync (shVect->win);
+    MPI_Barrier (comm_node);
+    MPI_Win_sync (shVect->win);
+}
+
+/*==============================================================================
+ *  SharedVectorFree
+ *=============================================================================*/
+
+static void SharedVectorFree (SharedVector *shVect) {
+
+    MPI_Win_unlock_all (shVect->win);
+    MPI_Win_free (&shVect->win);
+
+    MPI_Comm_free (&shVect->comm_colm_node);
+    if (shVect->comm_colm_leaders != MPI_COMM_NULL) {
+        MPI_Comm_free (&shVect->comm_colm_leaders);
+    }
+}
+
+
+/*==============================================================================
+ *  CommPlanRun
+ *=============================================================================*/
+
+static void CommPlanRun (MPI_Request *req) {
+
+    MPI_Start (req);
+    MPI_Wait (req, MPI_STATUS_IGNORE);
+}
+
+/*==============================================================================
+ *  CommPlanFree
+ *=============================================================================*/
+
+static void CommPlanFree (CommPlan *plan) {
+
+    MPI_Request * reqs[] = { &plan->reduce, &plan->transpose, &plan->bcast, &plan->gather[0], &plan->gather[1] };
+
+    for (size_t i = 0; i < sizeof(reqs) / sizeof(reqs[0]); i++) {
+        if (*reqs[i] != MPI_REQUEST_NULL) {
+            MPI_Request_free (reqs[i]);
+        }
+    }
+}
+
+
+/*==============================================================================
+ *  InitVector
+ *=============================================================================*/
+
+void InitVector (matElem_t ** vectorCur, int matColmSize, int indexValue) {
+
+    int i;
+    matElem_t * vector = new matElem_t [matColmSize];
+
+    (*vectorCur) = vector;
+    int  myWorldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myWorldRank);
+
+    DLOG (C_VERBOSE, "Node[%d] Enter\n", myWorldRank);
+
+    if (indexValue == NULL_MATRIX) {
+
+        memset (vector, 0, matColmSize * sizeof(matElem_t));
+
+    } else if (indexValue == INCREMENTAL_VAL_ELEM) {
+        /* set elements in a particular order */
+
+        for (i = 0; i < matColmSize ; i++ ) {
+            vector[i] = i; 
+
+
+        }
+
+    } else if (indexValue == ALL_SET_1) {
+
+        for (i = 0; i < matColmSize ; i++ ) {
+
+            vector[i] = 1; 
+
+        }
+
+    }
+
+
+    DLOG (C_VERBOSE, "Node[%d] Exit\n", myWorldRank);
+}
+
+
+/*==============================================================================
+ *  printMatrix
+ *=============================================================================*/
+
+void printMatrix (matElem_t **mat, int rows, int colms)
+{
+    int i, j;
+
+    for (i = 0; i < rows; i++)
+    {
+        for (j = 0; j < colms; j++)
+        {
+            std::cout<<mat[i][j]<<" ";
+        }
+        std::cout<<std::endl;
+    }
+}
+
+/*==============================================================================
+ *  printVector
+ *=============================================================================*/
+
+void printVector (matElem_t *vect, int rows)
+{
+    int i;
+
+    for (i = 0; i < rows; i++)
+    {
+        std::cout<<vect[i]<<" ";
+    }
+    std::cout<<std::endl;
+
+}
+
+
+#if !(MOD_ARITH)
+/*==============================================================================
+ *  MatVec
+ *=============================================================================*/
+
+static void MatVec (matElem_t **mat, const matElem_t *vectIn, matElem_t *vectOut, int rows, int colms, int tileSize)
+{
+    int i, j, tStart, tEnd;
+
+    if (tileSize <= 0 || tileSize > colms) {
+        tileSize = colms;
+    }
+
+    memset (vectOut, 0, rows * sizeof(matElem_t));
+
+    /* a tile of X is reused by all the rows while it is still in the cache */
+    for (tStart = 0; tStart < colms; tStart += tileSize) {
+
+        tEnd = (colms - tStart > tileSize) ? tStart + tileSize : colms;
+
+        for (i = 0; i < rows; i++) {
+
+            const matElem_t * row = mat[i];
+            matElem_t rowSum = vectOut[i];
+
+            for (j = tStart; j < tEnd; j++) {
+                rowSum = rowSum + vectIn[j] * row[j];
+            }
+            vectOut[i] = rowSum;
+        }
+    }
+}
+#endif
+
+
+#if (MOD_ARITH)
+/*==============================================================================
+ *  MulHi64
+ *=============================================================================*/
+
+/* high 64 bits of a 64 x 64 bit product, from 32 x 32 bit products so that it vectorizes */
+static inline uint64_t MulHi64 (uint64_t a, uint64_t b)
+{
+    uint64_t aLo = a & 0xffffffffULL, aHi = a >> 32;
+    uint64_t bLo = b & 0xffffffffULL, bHi = b >> 32;
+    uint64_t loLo = aLo * bLo, loHi = aLo * bHi, hiLo = aHi * bLo, hiHi = aHi * bHi;
+    uint64_t mid = (loLo >> 32) + (loHi & 0xffffffffULL) + (hiLo & 0xffffffffULL);
+
+    return hiHi + (loHi >> 32) + (hiLo >> 32) + (mid >> 32);
+}
+
+/*==============================================================================
+ *  ModReduce
+ *=============================================================================*/
+
+/* Barrett reduction of a 64 bit value to its residue mod MOD_PRIME */
+static inline uint64_t ModReduce (uint64_t value)
+{
+    uint64_t quot = MulHi64 (value, MOD_BARRETT);
+    /* the remainder is below 2 MOD_PRIME < 2^32, so it is computed in 32 bits where the multiply vectorizes */
+    uint32_t rem = (uint32_t) value - (uint32_t) quot * (uint32_t) MOD_PRIME;
+
+    /* the estimated quotient is off by at most one */
+    return (rem >= (uint32_t) MOD_PRIME) ? rem - (uint32_t) MOD_PRIME : rem;
+}
+
+/*==============================================================================
+ *  ModDot
+ *=============================================================================*/
+
+/* dot product of a run of a row of A with the matching run of X mod MOD_PRIME */
+static inline matElem_t ModDot (const matElem_t *row, const matElem_t *vect, int len)
+{
+    int j = 0, l;
+    uint64_t lane[MOD_LANES] = {0};
+    uint64_t rowSum = 0;
+    /* a reduced lane takes MOD_LAZY_TERMS - 1 more products before it could overflow */
+    uint64_t laneTerms = (MOD_LAZY_TERMS - 1 < (1ULL << 24)) ? MOD_LAZY_TERMS - 1 : (1ULL << 24);
+    int blockLen = (int) laneTerms * MOD_LANES;
+
+    /*
+     * every lane accumulates the products of its own columns over the whole row & is reduced
+     * on its own, both the products & the Barrett step run on all the lanes at once
+     */
+    while (len - j >= MOD_LANES) {
+
+        int jEnd = j + ((len - j < blockLen) ? (len - j) / MOD_LANES * MOD_LANES : blockLen);
+
+        for (; j < jEnd; j += MOD_LANES) {
+#pragma omp simd
+            for (l = 0; l < MOD_LANES; l++) {
+                lane[l] += (uint64_t) row[j + l] * vect[j + l];
+            }
+        }
+
+#pragma omp simd
+        for (l = 0; l < MOD_LANES; l++) {
+            lane[l] = ModReduce (lane[l]);
+        }
+    }
+
+    /* the lanes are reduced, so each takes one product of the last few columns */
+    for (l = 0; j < len; j++, l++) {
+        lane[l] += (uint64_t) row[j] * vect[j];
+    }
+
+    for (l = 0; l < MOD_LANES; l++) {
+        rowSum += ModReduce (lane[l]);
+    }
+
+    return (matElem_t) ModReduce (rowSum);
+}
+
+/*==============================================================================
+ *  MatVecMod
+ *=============================================================================*/
+
+static void MatVecMod (matElem_t **mat, const matElem_t *vectIn, matElem_t *vectOut, int rows, int colms, int tileSize)
+{
+    int i, tStart, tEnd;
+
+    if (tileSize <= 0 || tileSize > colms) {
+        tileSize = colms;
+    }
+
+    for (tStart = 0; tStart < colms; tStart += tileSize) {
+
+        tEnd = (colms - tStart > tileSize) ? tStart + tileSize : colms;
+
+        for (i = 0; i < rows; i++) {
+
+            matElem_t partSum = ModDot (&mat[i][tStart], &vectIn[tStart], tEnd - tStart);
+
+            if (tStart == 0) {
+                vectOut[i] = partSum;
+            } else {
+                /* residues are below 2^31, so the sum of two fits */
+                matElem_t sum = vectOut[i] + partSum;
+                vectOut[i] = (sum >= (matElem_t) MOD_PRIME) ? sum - (matElem_t) MOD_PRIME : sum;
+            }
+        }
+    }
+}
+
+/*==============================================================================
+ *  ModSumOp
+ *=============================================================================*/
+
+static void ModSumOp (void *in, void *inout, int *len, MPI_Datatype *type)
+{
+    int i;
+    const matElem_t * inVect = (const matElem_t *) in;
+    matElem_t * inoutVect = (matElem_t *) inout;
+
+    (void) type;
+
+    for (i = 0; i < *len; i++) {
+        matElem_t sum = inVect[i] + inoutVect[i];
+        inoutVect[i] = (sum >= (matElem_t) MOD_PRIME) ? sum - (matElem_t) MOD_PRIME : sum;
+    }
+}
+#endif
+
+
+/*==============================================================================
+ *  RowDot
+ *=============================================================================*/
+
+/* dot product of a run of a row of A with the matching run of X */
+static inline matElem_t RowDot (const matElem_t *row, const matElem_t *vect, int len)
+{
+#if (MOD_ARITH)
+    return ModDot (row, vect, len);
+#else
+    matElem_t rowSum = 0;
+
+    for (int j = 0; j < len; j++) {
+        rowSum = rowSum + vect[j] * row[j];
+    }
+
+    return rowSum;
+#endif
+}
+
+/*==============================================================================
+ *  MatVecStructured
+ *=============================================================================*/
+
+static void MatVecStructured (const BlockStructure *shape, matElem_t **mat, const matElem_t *vectIn, matElem_t *vectOut, int rows, int colms)
+{
+    int i, jStart, jEnd;
+
+    if (shape->kind == BLOCK_DIAGONAL) {
+
+        for (i = 0; i < rows; i++) {
+            vectOut[i] = (i < colms) ? RowDot (&mat[i][i], &vectIn[i], 1) : 0;
+        }
+
+    } else if (shape->kind == BLOCK_BANDED) {
+
+        /* only the columns of row i inside the band, the rows above or below it give an empty run */
+        for (i = 0; i < rows; i++) {
+
+            jStart = (i + shape->bandLow > 0) ? i + shape->bandLow : 0;
+            jEnd = (i + shape->bandHigh + 1 < colms) ? i + shape->bandHigh + 1 : colms;
+
+            vectOut[i] = (jStart < jEnd) ? RowDot (&mat[i][jStart], &vectIn[jStart], jEnd - jStart) : 0;
+        }
+
+    } else if (shape->kind == BLOCK_TOEPLITZ) {
+
+        /* row i of the block is diags[rows - 1 - i ...], the whole block is read from 2b - 1 values */
+        for (i = 0; i < rows; i++) {
+            vectOut[i] = RowDot (&shape->diags[rows - 1 - i], vectIn, colms);
+        }
+    }
+}
+
+} /* namespace DISTMATMUL_ABI */
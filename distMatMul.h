@@ -0,0 +1,274 @@
+/*
+ * File Name       :distMatMul.h
+ *
+ * Distributed matrix-vector multiplication with block decomposition based partitioning.
+ * A DistributedMatrix session sets up the grid, communicators, datatypes & the distributed
+ * matrix A once, X(k) = A^k X(0) can then be computed any no of times without setting them up again.
+ *
+ */
+#ifndef DISTMATMUL_H
+#define DISTMATMUL_H
+
+#include <mpi.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "CommonHeader.h"
+#include "topology.h"
+
+/*
+ * Modular arithmetic mode, if set to 1 the matrix & vectors are stored as residues mod MOD_PRIME
+ * and x(k) is computed exactly instead of overflowing the 64 bit integers
+ */
+#ifndef MOD_ARITH
+#define MOD_ARITH 0
+#endif
+
+#if (MOD_ARITH)
+/* prime modulus, must be below 2^31 so that the sum of two residues fits in 32 bits, may be given as a plain int */
+#ifndef MOD_PRIME
+#define MOD_PRIME 1000000007ULL
+#endif
+/* Barrett constant floor(2^64 / MOD_PRIME) */
+#define MOD_BARRETT (UINT64_MAX / ((uint64_t) (MOD_PRIME)))
+/* no of products of two residues that can be summed in a 64 bit lane before it has to be reduced */
+#define MOD_LAZY_TERMS (UINT64_MAX / ((((uint64_t) (MOD_PRIME)) - 1) * (((uint64_t) (MOD_PRIME)) - 1)))
+
+static_assert (((uint64_t) (MOD_PRIME)) > 2 && ((uint64_t) (MOD_PRIME)) < (1ULL << 31), "MOD_PRIME should be an odd prime below 2^31");
+
+typedef uint32_t matElem_t;
+#define MAT_ELEM_MPI_TYPE MPI_UINT32_T
+#define DISTMATMUL_ABI distMatMulMod
+#else
+typedef long long int matElem_t;
+#define MAT_ELEM_MPI_TYPE MPI_LONG_LONG_INT
+#define DISTMATMUL_ABI distMatMulI64
+#endif
+
+/*
+ * contents of the generated matrix & vectors
+ */
+#define NULL_MATRIX 0
+#define IDENTITY_MATRIX 1
+#define SPARSE_MATRIX 2
+#define INCREMENTAL_VAL_ELEM 3
+#define ALL_SET_1 4
+#define BANDED_MATRIX 5
+#define DENSE_MATRIX 6
+
+/*
+ * structure of the block of A held by a rank, detected once when the block is generated.
+ * Every kind has its own kernel, a zero block is not multiplied at all.
+ */
+#define BLOCK_DENSE 0
+#define BLOCK_ZERO 1
+#define BLOCK_DIAGONAL 2        /* non zeros only at (i,i) */
+#define BLOCK_BANDED 3          /* non zeros only on the diagonals j - i = bandLow ... bandHigh */
+#define BLOCK_TOEPLITZ 4        /* every diagonal is constant, A(i,j) = diags[j - i + rows - 1] */
+
+/*
+ * the library is built for one mode, libdistMatMul.a or libdistMatMulMod.a (make modular=1). Everything it
+ * exports lives in a namespace named after the mode, so a client compiled for the other mode fails to link
+ * instead of passing elements of the wrong size.
+ */
+inline namespace DISTMATMUL_ABI {
+
+/* run time options of a session */
+struct MatMulOptions {
+    int pinRanks;       /* 1 - pin every rank to a core */
+    int hugePage;       /* HUGE_PAGE_NONE, HUGE_PAGE_2M or HUGE_PAGE_1G */
+    int sharedVector;   /* 1 - ranks of a host read X from a shared memory window */
+    int hierColl;       /* 1 - host aware grid placement & two level reduce / broadcast */
+    int rmaTranspose;   /* 1 - one sided transfer of the reduced result to the column leaders */
+    int persistComm;    /* 1 - persistent requests for the communication in the iteration loop */
+    int tileSize;       /* columns of the block multiplied at a time, 0 - whole rows */
+    int balanceInterval;/* > 0 - resize the blocks to the measured compute speed of the ranks every balanceInterval iterations */
+};
+
+/*
+ * X(t-1) segment of a grid column shared by all the ranks of the column on a host.
+ * It is double buffered, an iteration reads one slot & the host leader writes the other.
+ */
+struct SharedVector {
+    MPI_Win win;
+    MPI_Comm comm_colm_node;        /* ranks of the grid column on this host */
+    MPI_Comm comm_colm_leaders;     /* host leaders of the grid column, MPI_COMM_NULL on the other ranks */
+    matElem_t * slot[2];
+};
+
+/*
+ * persistent requests of the communication in the iteration loop, created once per session
+ * & started every iteration. MPI_REQUEST_NULL for the steps done with the blocking calls.
+ */
+struct CommPlan {
+    MPI_Request reduce;         /* row reduce, MPI-4 only */
+    MPI_Request transpose;      /* send or receive of the row result */
+    MPI_Request bcast;          /* column broadcast, MPI-4 only */
+    MPI_Request gather[2];      /* gather of X(k) at node 0, one per slot of the shared window X can be in, MPI-4 only */
+};
+
+struct BlockStructure {
+    int kind;
+    int bandLow, bandHigh;      /* BLOCK_BANDED only */
+    matElem_t * diags;          /* rows + colms - 1 values, BLOCK_TOEPLITZ only */
+};
+
+/*
+ * fills the block of A with the rows rowOffset ... rowOffset + rows - 1 & the columns colmOffset ... colmOffset + colms - 1,
+ * block[i][j] = A(rowOffset + i, colmOffset + j). The block is zeroed before, so only the non zeros have to be set.
+ * In the modular arithmetic mode the elements should be residues below MOD_PRIME.
+ * ctx - passed through from DistributedMatrix::Create
+ */
+typedef void (*MatrixBlockFn) (matElem_t **block, int rowOffset, int colmOffset, int rows, int colms, void *ctx);
+
+/* function sets all the options to their defaults, i.e. everything off */
+void DefaultOptions (MatMulOptions *opts);
+/* function allocates memory & initializes the block of A starting at row rowOffset & column colmOffset of A */
+void InitMatrix (matElem_t *** matCur, int matRowSize, int matColmSize, int rowOffset, int colmOffset,
+        int indexValue, int hugePage, size_t *mappedBytes);
+/* function sets the block of A starting at row rowOffset & column colmOffset of A to the generated matrix indexValue */
+void FillMatrix (matElem_t **mat, int matRowSize, int matColmSize, int rowOffset, int colmOffset, int indexValue);
+/* function detects the structure of a block of A */
+void ClassifyBlock (matElem_t **mat, int rows, int colms, BlockStructure *shape);
+/* function frees the values kept by ClassifyBlock */
+void FreeBlockStructure (BlockStructure *shape);
+/* function frees the matrix A */
+void FreeMatrix (matElem_t ** matCur, size_t mappedBytes);
+/* function allocates memory & initializes the vector X */
+void InitVector (matElem_t ** vectorCur, int matColmSize, int indexValue);
+/* function to print the matrix of amy dimention */
+void printMatrix(matElem_t **mat, int rows, int colms);
+/* function to print the vector of amy dimention */
+void printVector (matElem_t *vect, int rows);
+
+/*
+ * a matSize x matSize matrix distributed in blocks over a sqrt(p) x sqrt(p) grid of the ranks of a communicator.
+ * All the methods are collective over that communicator. X is passed in & out at rank 0 only.
+ * A session owns its communicators, windows & the block of A, so it can not be copied. The destructor
+ * calls Destroy, which is collective & uses MPI, so Destroy should be called before MPI_Finalize.
+ */
+class DistributedMatrix {
+
+public:
+    DistributedMatrix ();
+    ~DistributedMatrix ();
+
+    DistributedMatrix (const DistributedMatrix &) = delete;
+    DistributedMatrix & operator= (const DistributedMatrix &) = delete;
+
+    /*
+     * sets up the grid, communicators, datatypes & the block of A on every rank
+     * comm    - ranks to distribute A over, the no of ranks should be a perfect square
+     * matSize - rows & columns of A, a multiple of sqrt(no of ranks)
+     * matType - IDENTITY_MATRIX, SPARSE_MATRIX ..., generator of A
+     * opts    - placement & communication variants
+     */
+    CStatus Create (MPI_Comm comm, int matSize, int matType, const MatMulOptions &opts);
+    /*
+     * the same with A supplied by the caller, fillBlock is called once on every rank with the block it holds
+     * fillBlock - fills a block of A, see MatrixBlockFn
+     * ctx       - passed to fillBlock as is
+     */
+    CStatus Create (MPI_Comm comm, int matSize, MatrixBlockFn fillBlock, void *ctx, const MatMulOptions &opts);
+    /* frees everything set up by Create, the object can be created again */
+    void Destroy ();
+    /*
+     * changes the communication variants, the tile size & the balance interval of a created session, A is kept.
+     * The placement options pinRanks, hugePage & hierColl are fixed by Create, C_UNSUPPORTED if they differ.
+     */
+    CStatus SetOptions (const MatMulOptions &opts);
+
+    /*
+     * x = A^k x, x holds matSize elements at rank 0 of the communicator & is not used at the other ranks.
+     * k should be the same on all the ranks, C_INVALID_ARGS is returned on every rank if it is not or x is NULL at rank 0
+     */
+    CStatus Iterate (matElem_t *x, int k);
+    /* x = A x */
+    CStatus Multiply (matElem_t *x);
+
+    /*
+     * no of elements of X held by the grid column of the calling rank, the same for all the columns until rebalanced.
+     * The accessors return 0, or -1 for BlockKind, when the session is not created.
+     */
+    int SegmentSize () const { return created ? subVecColmSize : 0; }
+    int MatSize () const { return created ? matSize : 0; }
+    /* structure of the block of A held by the calling rank, BLOCK_DENSE, BLOCK_ZERO ... */
+    int BlockKind () const { return created ? blockShape.kind : -1; }
+
+private:
+    /* copies X to the 1st row nodes & broadcasts it in the columns */
+    void Distribute (const matElem_t *x);
+    /* computes X(t) from X(t-1), leaving it in vectorPast of every node */
+    void Step ();
+    /* gathers X from the 1st row nodes at rank 0 */
+    void Collect (matElem_t *x);
+
+    void CreateComms ();
+    /* sets up everything sized by the segments of X, the vectors, datatype, windows & persistent requests */
+    void CreateLayout ();
+    void FreeLayout ();
+    void CreateTranspose ();
+    void CreatePlan ();
+
+    /* gathers the compute times at rank 0 & returns 1 if the blocks should be resized to newPartition */
+    int PlanBalance (int *newPartition);
+    /* moves A to the blocks of newPartition & sets up the layout again, X should be collected before */
+    void Rebalance (const int *newPartition);
+    void MigrateMatrix (const int *newPartition);
+
+    int created;
+    MatMulOptions opts;
+
+    MPI_Comm comm;                  /* communicator of the session, not owned */
+    int myRank, numprocs;
+    int matSize;
+    int subMatRowSize, subMatColmSize, subVecColmSize;
+
+    MPI_Comm comm_node;             /* ranks of comm on this host */
+    MPI_Comm grid_comm;
+    MPI_Comm comm_row;
+    MPI_Comm comm_colm;
+    int gridDim;
+    int gridRank;
+    int grid_coords[2];
+    int rowRank, colmRank;
+
+    /*
+     * the rows & the columns of A are both split at partition[0] = 0 < partition[1] ... < partition[gridDim] = matSize,
+     * the node (r,c) holds the rows partition[r] ... & the columns partition[c] ... of A
+     */
+    int * partition;
+    int * segCounts;                /* partition[k + 1] - partition[k] */
+    double computeTime;             /* seconds spent in the kernel since the last balance check */
+    int balanceSteps;               /* iterations since the last balance check */
+    double * blockRates;            /* time per element of work of every block, kept at rank 0 */
+
+    matElem_t ** matrix;
+    size_t matrixBytes;
+    BlockStructure blockShape;
+    matElem_t * vectorPast;
+    matElem_t * vectorCur;
+    matElem_t * vectorResult;
+    matElem_t * vectorFinalResult;  /* X gathered at rank 0 */
+
+    MPI_Datatype vectType;
+    MPI_Op vectSumOp;
+
+    TopoHierComm hier_row;
+    TopoHierComm hier_colm;
+
+    SharedVector shVect;
+    int curSlot;                    /* slot of shVect holding X(t-1) */
+
+    int isTransposeOrigin;          /* (i,0) nodes send the row result to (0,i) */
+    int isTransposeTarget;
+    int transposeRank;
+    MPI_Win resultWin;
+    MPI_Group transposeGroup;
+
+    CommPlan plan;
+};
+
+} /* namespace DISTMATMUL_ABI */
+
+#endif /* DISTMATMUL_H */
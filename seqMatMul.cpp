@@ -10,6 +10,11 @@
  *
  * To compile :
  * g++ -std=c++11 seqMatMul.cpp -o seqMatMul
+ * g++ -std=c++11 -DMOD_ARITH=1 seqMatMul.cpp -o seqMatMul    (x(k) mod MOD_PRIME, as matMul built with make modular=1)
+ *
+ * Options :
+ * -matrix identity|sparse|banded|dense   generator of A, the same matrices as matMul -matrix
+ * -print                                 print x(20) to stdout, one element per line, to compare it with matMul -print
  * 
  * Sample command line execution :
  * 
@@ -27,6 +32,16 @@
 #define SPARSE_MATRIX 2
 #define INCREMENTAL_VAL_ELEM 3
 #define ALL_SET_1 4
+#define BANDED_MATRIX 5
+#define DENSE_MATRIX 6
+
+/* modular arithmetic mode, the same modulus as libdistMatMul */
+#ifndef MOD_ARITH
+#define MOD_ARITH 0
+#endif
+#if (MOD_ARITH) && !defined(MOD_PRIME)
+#define MOD_PRIME 1000000007ULL
+#endif
 
 #include <stdio.h>
 #include <iostream>
@@ -57,8 +72,33 @@ void printVector (long long int *vect, int rows);
 int main (int argc, char* argv[]) {
 
 
-    if (argc < 2) {
-        std::cerr<<"Usage: "<<argv[0]<<" <matSize>"<<std::endl;
+    int matType = IDENTITY_MATRIX;
+    int print = 0;
+    int arg;
+
+    for (arg = 2; arg < argc; arg++) {
+        if (strcmp (argv[arg], "-print") == 0) {
+            print = 1;
+        } else if (strcmp (argv[arg], "-matrix") == 0 && arg + 1 < argc) {
+            arg++;
+            if (strcmp (argv[arg], "identity") == 0) {
+                matType = IDENTITY_MATRIX;
+            } else if (strcmp (argv[arg], "sparse") == 0) {
+                matType = SPARSE_MATRIX;
+            } else if (strcmp (argv[arg], "banded") == 0) {
+                matType = BANDED_MATRIX;
+            } else if (strcmp (argv[arg], "dense") == 0) {
+                matType = DENSE_MATRIX;
+            } else {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+
+    if (argc < 2 || arg < argc) {
+        std::cerr<<"Usage: "<<argv[0]<<" <matSize> [-matrix identity|sparse|banded|dense] [-print]"<<std::endl;
 
         return -1;
     }
@@ -84,7 +124,7 @@ int main (int argc, char* argv[]) {
     StartTime = std::chrono::system_clock::now();
 
 
-    InitMatrix (&matrix, subMatRowSize, subMatColmSize, IDENTITY_MATRIX);
+    InitMatrix (&matrix, subMatRowSize, subMatColmSize, matType);
 
     firstRow = 0 ;
     lastRow  = subMatRowSize - 1;
@@ -119,7 +159,11 @@ int main (int argc, char* argv[]) {
 
             for (j = 0; j < subMatColmSize; j++) {
 
+#if (MOD_ARITH)
+                vectorCur[i] = (vectorCur[i] + vectorPast[j] * matrix[i][j]) % MOD_PRIME;
+#else
                 vectorCur[i] = vectorCur[i] + vectorPast[j] * matrix[i][j];   
+#endif
             }
         }
 
@@ -144,6 +188,12 @@ int main (int argc, char* argv[]) {
 
     std::cerr<<ElapsedTime.count()<<std::endl;
 
+    if (print) {
+        for (i = 0; i < matSize; i++) {
+            std::cout<<vectorPast[i]<<std::endl;
+        }
+    }
+
     delete [] vectorCur;
     delete [] vectorPast;
 
@@ -218,6 +268,28 @@ void InitMatrix (long long int *** matCur, int matRowSize, int matColmSize, int
             }
         }
 
+    } else if (indexValue == BANDED_MATRIX) {
+        /* tridiagonal matrix, 2 on the diagonal & 1 next to it */
+        for (i = 0; i < matRowSize ; i++ ) {
+            for ( j = 0; j < matColmSize ; j++ ) {
+
+                if ( i == j) {
+                    matrix[i][j] = 2; 
+                } else if ( i - j == 1 || j - i == 1) {
+                    matrix[i][j] = 1; 
+                } else {
+                    matrix[i][j] = 0; 
+                }
+            }
+        }
+
+    } else if (indexValue == DENSE_MATRIX) {
+        /* values 0 ... 10 with no structure */
+        for (i = 0; i < matRowSize ; i++ ) {
+            for ( j = 0; j < matColmSize ; j++ ) {
+                matrix[i][j] = ((long long int) i * 31 + (long long int) j * 17) % 11; 
+            }
+        }
 
     }
 
@@ -232,7 +304,7 @@ void InitMatrix (long long int *** matCur, int matRowSize, int matColmSize, int
 
 void InitVector (long long int ** vectorCur, int matColmSize, int indexValue) {
 
-    int i,j;
+    int i;
     long long int * vector = new long long int [matColmSize];
 
     (*vectorCur) = vector;
@@ -292,7 +364,7 @@ void printMatrix (long long int **mat, int rows, int colms)
 
 void printVector (long long int *vect, int rows)
 {
-    int i, j;
+    int i;
 
     for (i = 0; i < rows; i++)
     {
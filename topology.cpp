@@ -0,0 +1,422 @@
+/*
+ * File Name   :topology.cpp
+ * Description :Node topology discovery from /sys, pinning of the ranks to cores, allocation of
+ *              the large matrix blocks with optional huge page backing & host aware collectives
+ *
+ */
+
+/* Debug prints will be enabled if set to 1 */
+#define DEBUG 0
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <cmath>
+#include <vector>
+
+#include "topology.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+#define SYS_NODE_DIR "/sys/devices/system/node"
+#define SYS_CPU_DIR "/sys/devices/system/cpu"
+
+#define HUGE_PAGE_2M_SIZE (2UL << 20)
+#define HUGE_PAGE_1G_SIZE (1UL << 30)
+
+
+/*==============================================================================
+ *  ReadCpuList
+ *=============================================================================*/
+
+/* parses a /sys cpu list file of the form "0-3,8,10-11" */
+static CStatus ReadCpuList (const char *path, std::vector<int> &cpus)
+{
+    FILE * fp = fopen (path, "r");
+    char line[4096];
+
+    cpus.clear();
+    if (fp == NULL) {
+        return C_FAILURE;
+    }
+
+    if (fgets (line, sizeof(line), fp) == NULL) {
+        fclose (fp);
+        return C_FAILURE;
+    }
+    fclose (fp);
+
+    char * save = NULL;
+    for (char * tok = strtok_r (line, ",\n", &save); tok != NULL; tok = strtok_r (NULL, ",\n", &save)) {
+
+        int first, last;
+        int fields = sscanf (tok, "%d-%d", &first, &last);
+
+        if (fields == 1) {
+            last = first;
+        } else if (fields != 2) {
+            continue;
+        }
+
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back (cpu);
+        }
+    }
+
+    return C_SUCCESS;
+}
+
+/*==============================================================================
+ *  IsPrimaryThread
+ *=============================================================================*/
+
+/* true if the cpu is the first hardware thread of its core */
+static bool IsPrimaryThread (int cpu)
+{
+    char path[256];
+    std::vector<int> siblings;
+
+    snprintf (path, sizeof(path), SYS_CPU_DIR "/cpu%d/topology/thread_siblings_list", cpu);
+    if (ReadCpuList (path, siblings) != C_SUCCESS || siblings.empty()) {
+        return true;
+    }
+
+    return siblings[0] == cpu;
+}
+
+/*==============================================================================
+ *  GetNumaCpus
+ *=============================================================================*/
+
+/*
+ * lists the cpus of every NUMA node which the calling process is allowed to run on,
+ * one hardware thread per core where possible. Nodes without usable cpus are left out.
+ */
+static void GetNumaCpus (std::vector< std::vector<int> > &nodeCpus)
+{
+    cpu_set_t allowed;
+    std::vector<int> nodes;
+    char path[256];
+
+    nodeCpus.clear();
+
+    CPU_ZERO (&allowed);
+    if (sched_getaffinity (0, sizeof(allowed), &allowed) != 0) {
+        return;
+    }
+
+    /* machines without NUMA support in the kernel have no node directory, treat them as a single node */
+    if (ReadCpuList (SYS_NODE_DIR "/online", nodes) != C_SUCCESS) {
+        nodes.assign (1, -1);
+    }
+
+    for (size_t n = 0; n < nodes.size(); n++) {
+
+        std::vector<int> cpus, usable, primary;
+
+        if (nodes[n] < 0) {
+            ReadCpuList (SYS_CPU_DIR "/online", cpus);
+        } else {
+            snprintf (path, sizeof(path), SYS_NODE_DIR "/node%d/cpulist", nodes[n]);
+            ReadCpuList (path, cpus);
+        }
+
+        for (size_t c = 0; c < cpus.size(); c++) {
+            if (cpus[c] < CPU_SETSIZE && CPU_ISSET (cpus[c], &allowed)) {
+                usable.push_back (cpus[c]);
+                if (IsPrimaryThread (cpus[c])) {
+                    primary.push_back (cpus[c]);
+                }
+            }
+        }
+
+        if (!primary.empty()) {
+            nodeCpus.push_back (primary);
+        } else if (!usable.empty()) {
+            nodeCpus.push_back (usable);
+        }
+    }
+}
+
+/*==============================================================================
+ *  TopoNumaNodeCount
+ *=============================================================================*/
+
+int TopoNumaNodeCount (void)
+{
+    std::vector< std::vector<int> > nodeCpus;
+
+    GetNumaCpus (nodeCpus);
+
+    return (int) nodeCpus.size();
+}
+
+/*==============================================================================
+ *  TopoPinRank
+ *=============================================================================*/
+
+CStatus TopoPinRank (int localRank, int localSize, int *pinnedCpu)
+{
+    std::vector< std::vector<int> > nodeCpus;
+    cpu_set_t mask;
+
+    DLOG (C_VERBOSE, "Enter localRank = %d localSize = %d\n", localRank, localSize);
+
+    *pinnedCpu = -1;
+    GetNumaCpus (nodeCpus);
+    if (nodeCpus.empty() || localSize <= 0) {
+        DLOG (C_WARNING, "could not read the cpu topology, rank is not pinned\n");
+        return C_FAILURE;
+    }
+
+    /* rank r goes to NUMA node floor(r * numNodes / localSize), whose first rank is ceil(node * localSize / numNodes) */
+    int numNodes = (int) nodeCpus.size();
+    int node = (int) (((long) localRank * numNodes) / localSize);
+    int firstRank = (int) (((long) node * localSize + numNodes - 1) / numNodes);
+    const std::vector<int> &cpus = nodeCpus[node];
+
+    *pinnedCpu = cpus[(localRank - firstRank) % cpus.size()];
+
+    CPU_ZERO (&mask);
+    CPU_SET (*pinnedCpu, &mask);
+    if (sched_setaffinity (0, sizeof(mask), &mask) != 0) {
+        DLOG (C_WARNING, "could not pin rank to cpu %d\n", *pinnedCpu);
+        *pinnedCpu = -1;
+        return C_FAILURE;
+    }
+
+    DLOG (C_VERBOSE, "Exit localRank = %d pinned to cpu %d on NUMA node %d\n", localRank, *pinnedCpu, node);
+    return C_SUCCESS;
+}
+
+/*==============================================================================
+ *  TopoAllocBlock
+ *=============================================================================*/
+
+void * TopoAllocBlock (size_t bytes, int hugePage, size_t *mappedBytes)
+{
+    void * block = MAP_FAILED;
+
+    if (bytes == 0) {
+        bytes = 1;
+    }
+
+    if (hugePage == HUGE_PAGE_2M || hugePage == HUGE_PAGE_1G) {
+
+        size_t pageSize = (hugePage == HUGE_PAGE_2M) ? HUGE_PAGE_2M_SIZE : HUGE_PAGE_1G_SIZE;
+        int pageShift = (hugePage == HUGE_PAGE_2M) ? 21 : 30;
+        size_t hugeBytes = (bytes + pageSize - 1) / pageSize * pageSize;
+
+        block = mmap (NULL, hugeBytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (pageShift << MAP_HUGE_SHIFT), -1, 0);
+
+        if (block != MAP_FAILED) {
+            *mappedBytes = hugeBytes;
+            return block;
+        }
+        DLOG (C_WARNING, "no %s huge pages available, falling back to transparent huge pages\n",
+                (hugePage == HUGE_PAGE_2M) ? "2 MB" : "1 GB");
+    }
+
+    block = mmap (NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED) {
+        *mappedBytes = 0;
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (hugePage != HUGE_PAGE_NONE) {
+        madvise (block, bytes, MADV_HUGEPAGE);
+    }
+#endif
+
+    *mappedBytes = bytes;
+    return block;
+}
+
+/*==============================================================================
+ *  TopoFreeBlock
+ *=============================================================================*/
+
+void TopoFreeBlock (void *block, size_t mappedBytes)
+{
+    if (block != NULL) {
+        munmap (block, mappedBytes);
+    }
+}
+
+/*==============================================================================
+ *  TopoSplitNode
+ *=============================================================================*/
+
+CStatus TopoSplitNode (MPI_Comm comm, MPI_Comm *intraComm, MPI_Comm *interComm)
+{
+    int rank, intraRank;
+
+    MPI_Comm_rank (comm, &rank);
+
+    if (MPI_Comm_split_type (comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, intraComm) != MPI_SUCCESS) {
+        return C_FAILURE;
+    }
+    MPI_Comm_rank (*intraComm, &intraRank);
+
+    if (MPI_Comm_split (comm, (intraRank == 0) ? 0 : MPI_UNDEFINED, rank, interComm) != MPI_SUCCESS) {
+        MPI_Comm_free (intraComm);
+        return C_FAILURE;
+    }
+
+    return C_SUCCESS;
+}
+
+/*==============================================================================
+ *  TopoGridOrder
+ *=============================================================================*/
+
+CStatus TopoGridOrder (MPI_Comm comm, int gridDim, int *gridRank)
+{
+    MPI_Comm intraComm, interComm;
+    int rank, localRank, localSize, hostIndex = 0;
+    int sizeRange[2];
+    int tileRows = 0, tileColms = 0;
+
+    MPI_Comm_rank (comm, &rank);
+    *gridRank = rank;
+
+    if (TopoSplitNode (comm, &intraComm, &interComm) != C_SUCCESS) {
+        return C_FAILURE;
+    }
+    MPI_Comm_rank (intraComm, &localRank);
+    MPI_Comm_size (intraComm, &localSize);
+
+    /* hosts are numbered in the order of their lowest rank */
+    if (interComm != MPI_COMM_NULL) {
+        MPI_Comm_rank (interComm, &hostIndex);
+        MPI_Comm_free (&interComm);
+    }
+    MPI_Bcast (&hostIndex, 1, MPI_INT, 0, intraComm);
+    MPI_Comm_free (&intraComm);
+
+    /* {-min, max} of the no of ranks per host */
+    sizeRange[0] = -localSize;
+    sizeRange[1] = localSize;
+    MPI_Allreduce (MPI_IN_PLACE, sizeRange, 2, MPI_INT, MPI_MAX, comm);
+    if (-sizeRange[0] != sizeRange[1]) {
+        DLOG (C_WARNING, "hosts have different no of ranks, the grid is not reordered\n");
+        return C_UNSUPPORTED;
+    }
+
+    /* squarest tileRows x tileColms tile of localSize cells that tiles the grid */
+    for (int rows = (int) sqrt ((double) localSize); rows >= 1 && tileRows == 0; rows--) {
+
+        int colms = localSize / rows;
+
+        if (rows * colms != localSize) {
+            continue;
+        }
+        if (gridDim % rows == 0 && gridDim % colms == 0) {
+            tileRows = rows;
+            tileColms = colms;
+        }
+    }
+
+    if (tileRows == 0) {
+        DLOG (C_WARNING, "no tile of %d ranks fits a %d x %d grid, the grid is not reordered\n",
+                localSize, gridDim, gridDim);
+        return C_UNSUPPORTED;
+    }
+
+    int tilesPerRow = gridDim / tileColms;
+    int row = (hostIndex / tilesPerRow) * tileRows + localRank / tileColms;
+    int colm = (hostIndex % tilesPerRow) * tileColms + localRank % tileColms;
+
+    *gridRank = row * gridDim + colm;
+
+    DLOG (C_VERBOSE, "rank %d host %d local rank %d placed at (%d,%d) of %d x %d tile\n",
+            rank, hostIndex, localRank, row, colm, tileRows, tileColms);
+    return C_SUCCESS;
+}
+
+/*==============================================================================
+ *  TopoHierCreate
+ *=============================================================================*/
+
+CStatus TopoHierCreate (MPI_Comm comm, size_t scratchBytes, TopoHierComm *hier)
+{
+    hier->scratch = NULL;
+
+    if (TopoSplitNode (comm, &hier->intra, &hier->inter) != C_SUCCESS) {
+        return C_FAILURE;
+    }
+
+    if (hier->inter != MPI_COMM_NULL) {
+        hier->scratch = new char [scratchBytes];
+    }
+
+    return C_SUCCESS;
+}
+
+/*==============================================================================
+ *  TopoHierFree
+ *=============================================================================*/
+
+void TopoHierFree (TopoHierComm *hier)
+{
+    MPI_Comm_free (&hier->intra);
+    if (hier->inter != MPI_COMM_NULL) {
+        MPI_Comm_free (&hier->inter);
+    }
+    delete [] (char *) hier->scratch;
+    hier->scratch = NULL;
+}
+
+/*==============================================================================
+ *  TopoHierReduce
+ *=============================================================================*/
+
+int TopoHierReduce (const void *sendbuf, void *recvbuf, int count, MPI_Datatype type, MPI_Op op, TopoHierComm *hier)
+{
+    int intraSize, err;
+    const void * hostResult = sendbuf;
+
+    MPI_Comm_size (hier->intra, &intraSize);
+
+    if (intraSize > 1) {
+        err = MPI_Reduce (sendbuf, hier->scratch, count, type, op, 0, hier->intra);
+        if (err != MPI_SUCCESS) {
+            return err;
+        }
+        hostResult = hier->scratch;
+    }
+
+    if (hier->inter == MPI_COMM_NULL) {
+        return MPI_SUCCESS;
+    }
+
+    return MPI_Reduce (hostResult, recvbuf, count, type, op, 0, hier->inter);
+}
+
+/*==============================================================================
+ *  TopoHierBcast
+ *=============================================================================*/
+
+int TopoHierBcast (void *buf, int count, MPI_Datatype type, TopoHierComm *hier)
+{
+    int err;
+
+    if (hier->inter != MPI_COMM_NULL) {
+        err = MPI_Bcast (buf, count, type, 0, hier->inter);
+        if (err != MPI_SUCCESS) {
+            return err;
+        }
+    }
+
+    return MPI_Bcast (buf, count, type, 0, hier->intra);
+}
@@ -0,0 +1,84 @@
+/*
+ * File Name       :topology.h
+ *
+ * Node topology discovery from /sys, pinning of the ranks to cores, allocation of
+ * the large matrix blocks with optional huge page backing & host aware collectives
+ *
+ */
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stddef.h>
+#include <mpi.h>
+
+#include "CommonHeader.h"
+
+/*
+ * huge page backing of the matrix blocks
+ */
+
+/*! regular 4 KB pages */
+#define HUGE_PAGE_NONE             0
+/*! 2 MB huge pages, falls back to transparent huge pages */
+#define HUGE_PAGE_2M               1
+/*! 1 GB huge pages, falls back to transparent huge pages */
+#define HUGE_PAGE_1G               2
+
+/* returns the no of NUMA nodes on this host which have cpus usable by the calling process */
+int TopoNumaNodeCount (void);
+
+/*
+ * pins the calling rank to a single core. the ranks of a host are spread in blocks over the
+ * NUMA nodes, i.e. consecutive local ranks share a socket, & then over the physical cores of the node.
+ * localRank, localSize - rank & no of ranks on this host
+ * pinnedCpu            - the cpu the rank is pinned to
+ */
+CStatus TopoPinRank (int localRank, int localSize, int *pinnedCpu);
+
+/*
+ * maps an anonymous block of memory, backed with huge pages if requested. The pages are not
+ * touched here, so they get placed on the NUMA node of the thread that initializes them.
+ * mappedBytes - size of the mapping, needed by TopoFreeBlock
+ * returns NULL on failure
+ */
+void * TopoAllocBlock (size_t bytes, int hugePage, size_t *mappedBytes);
+
+/* unmaps a block allocated by TopoAllocBlock */
+void TopoFreeBlock (void *block, size_t mappedBytes);
+
+/*
+ * splits a communicator into the ranks sharing a host & the host leaders. The lowest rank of comm
+ * on every host is its leader, so rank 0 of comm is rank 0 of both the new communicators.
+ * intraComm - ranks of comm on this host
+ * interComm - one rank of comm per host, MPI_COMM_NULL on the ranks which are not host leaders
+ */
+CStatus TopoSplitNode (MPI_Comm comm, MPI_Comm *intraComm, MPI_Comm *interComm);
+
+/*
+ * places the ranks of comm on a gridDim x gridDim grid so that every host owns a rectangular tile
+ * of the grid, as square as possible, instead of a run of consecutive cells of a grid row.
+ * gridRank - row major position of the calling rank in the grid, rank 0 of comm stays at 0.
+ *            Set to the rank in comm when the hosts have different no of ranks or no tile fits.
+ */
+CStatus TopoGridOrder (MPI_Comm comm, int gridDim, int *gridRank);
+
+/*
+ * two level communicator, collectives on it run within the hosts & among the host leaders
+ * separately so only one message per host crosses the network
+ */
+struct TopoHierComm {
+    MPI_Comm intra;         /* ranks on this host */
+    MPI_Comm inter;         /* host leaders, MPI_COMM_NULL on the other ranks */
+    void * scratch;         /* partial result of the host, allocated on the host leaders */
+};
+
+/* creates the two level communicator, scratchBytes is the largest message reduced over it */
+CStatus TopoHierCreate (MPI_Comm comm, size_t scratchBytes, TopoHierComm *hier);
+/* frees the two level communicator */
+void TopoHierFree (TopoHierComm *hier);
+/* MPI_Reduce to rank 0 of the communicator, reducing within every host first */
+int TopoHierReduce (const void *sendbuf, void *recvbuf, int count, MPI_Datatype type, MPI_Op op, TopoHierComm *hier);
+/* MPI_Bcast from rank 0 of the communicator, to the host leaders first */
+int TopoHierBcast (void *buf, int count, MPI_Datatype type, TopoHierComm *hier);
+
+#endif /* TOPOLOGY_H */